@@ -23,16 +23,74 @@
 //TODO (maybe):
 //  - Add an Energy_Middle() function to allow more than two energy map threads.
 //  - Try doing Poisson image reconstruction instead of the averaging technique in CAIR_HD() if I can figure it out (see the ReadMe).
-//  - Abstract out pthreads into macros allowing for multiple thread types to be used (ugh, not for a while at least)
 //  - Maybe someday push CAIR into OO land and create a class out of it (pff, OO is the devil!).
 
 //=========================================================================================================//
 //KNOWN BUGS:
-//  - The threading changes in v2.16 lost the reentrant capability of CAIR. (If this hits someone hard, let me know.)
 //  - The percent of completion for the CAIR_callback in CAIR_HD and CAIR_Removal are often wrong.
 
 //=========================================================================================================//
 //CHANGELOG:
+//CAIR v2.18 Changelog:
+//  - Forward energy costs are now kept in three cost planes that are built along with the edge map and repaired locally around each
+//    seam, instead of being recomputed for every pixel of every seam. The energy map rows are now done with a plain add-and-min over
+//    row pointers, which the compiler can vectorize for both energy types.
+//  - The energy map now records the direction each pixel came from, so the path is a simple walk back up through the
+//    directions instead of re-comparing the energy values. CAIR_HD() and CAIR_Image_Map() only keep three rows of the
+//    energy map, since they don't need it around for the next seam.
+//  - Forward energy paths now follow the same costs that the energy map used to pick them.
+//  - When a path is removed or added, the energy map is now only updated where the path went through and where the values
+//    above it actually changed. The old cone around the path kept growing with every row, covering most of tall images.
+//  - Added CAIR_Batch(), an optional mode that has CAIR_Remove() take several paths that don't cross from each energy map and
+//    remove them all in one pass. Much faster for large reductions, at a slight cost in quality.
+//  - Added CAIR_Add_Mode(). SEAM_ORDER enlarges like the paper: the paths are found by removing them from a copy, then all of them
+//    are duplicated into the image in one pass. Enlarging now costs about the same as removing, with no shifting for each path.
+//  - CAIR_Add() now keeps the sum of the weights up to date along each added path, instead of adding the whole matrix every time.
+//  - Remove_Path() is now one sweep down the image. Each thread removes its rows and fixes the edges a row behind, while the
+//    calling thread finishes the rows between the strips and updates the energy as each strip comes in. No more waiting between steps.
+//  - Removing a row is now a single pass over raw row pointers. Average_Pixels() does all four channels at once as packed bytes, and
+//    Grayscale_Pixel() uses integer math instead of floor() on a double. Same output as before.
+//  - The threads are now started on the first CAIR call and kept running for the next ones, instead of being created and torn down
+//    every time. Added CAIR_Shutdown() to stop them.
+//  - CAIR is reentrant again. All of the settings, threads, and semaphores now live in a CAIR_Context, and every function has a version
+//    that takes one. Separate contexts can resize images at the same time. The old functions use a default context.
+//  - The separate gray, edge, add, remove, and energy threads are replaced by one set of worker threads. Each stage is handed to them
+//    as a set of tasks, a few strips per thread, and whoever is free takes the next one. The caller helps out while it waits.
+//  - The threads now check on what they're waiting for a little while before going to sleep on it, since most waits between the
+//    steps of a seam are over in a few microseconds. Workers are only woken through the kernel when they are actually asleep.
+//    There's no spinning on a single core.
+//  - CAIR_NUM_THREADS is now 0, which picks the thread count for each image from the number of cores and the size of the image.
+//    Images too small to be worth splitting up (and any image with CAIR_Threads( 1 )) are done on the calling thread, without
+//    any of the locking. The workers are only restarted when an image needs more of them.
+//  - Added CAIR_Affinity(), which pins the threads to cores and keeps each strip of the image on the same thread. The rows of each
+//    strip are moved into memory allocated by its thread, so they stay on its NUMA node. (Linux only)
+//  - Added CAIR_Backend(), which picks what runs the threads: CAIR's own pthreads pool, C++11 threads, OpenMP, or just the calling
+//    thread. CAIR_Executor() lets a program hand CAIR its own thread pool instead, so CAIR doesn't start any threads of its own.
+//  - Added CAIR_Start(), CAIR_Done(), CAIR_Cancel(), and CAIR_Finish(), which run CAIR() in the background. A cancel is checked
+//    every row inside the long steps, not just once per seam like the callback.
+//  - Added CAIR_Ladder(), which makes several narrower versions of an image from one carving run. Each width is copied out as
+//    the run passes it, so the seams on the way down to the narrowest one are only found once.
+//  - CAIR_HD() no longer transposes and recalculates everything for both directions on every path. It keeps both directions
+//    the whole way down, repairing the one the path came out of like CAIR() does, and shifting the other one's columns up with
+//    Remove_Cross(), which only recalculates the edges next to the path. Only the other direction's energy map is redone.
+//  - Added CAIR_Transport(), which plans the order of the paths down and across the image with the transport map from the
+//    paper, on a small copy of the image, and then removes them from the full image in that order.
+//  - Added CAIR_Pyramid(), an optional mode that finds paths on the edges summed into blocks, then refines each coarse path into
+//    several full size ones in a narrow band around it. Only that band of the full energy map is calculated for each path, and the
+//    coarse map is shifted and patched instead of summed up again.
+//  - Added CAIR_Seams() and CAIR_Replay(). The paths a resize removed and added can be kept, and then done again to a larger copy
+//    of the image. Each kept path is refined into several at full size in a band around it, the same way CAIR_Pyramid() does.
+//  - CAIR_Seam_List keeps each path as where it starts and then a signed char step for each row, a quarter of the memory it took.
+//    Added CAIR_Apply(), which carves any number of extra planes (masks, depth, labels, of any element type) along the kept paths.
+//    The paths are first worked out into which old pixel each new one came from, and then every plane is filled from that at once.
+//  - Added CAIR_Bands(), which splits very wide images into bands and carves them all at once, each with its own context on one
+//    of the threads. The bands get their share of the paths from where the lowest energy columns are, and are blended together
+//    over the columns they borrow from each other.
+//  - Added CAIR_Local(), which looks for each path near the last one first, in a band of the energy map like CAIR_Pyramid()'s. The
+//    full energy map is only brought up to date when the band's best is too far over the last full map's best path.
+//  - Added CAIR_Hybrid(), which carves within a budget of paths and time, and stops early once the paths cost about as much as an
+//    average path on the first energy map. Whatever is left is done by a threaded, fixed point resampler, so extreme resizes take
+//    a predictable time.
 //CAIR v2.17 Changelog:
 //  - Ditched vectors for dynamic arrays, for about a 15% performance boost.
 //  - Added some headers into CAIR_CML.h to fix some compilier errors with new versions of g++. (Special thanks to Alexandre Prokoudine)
@@ -177,14 +235,120 @@
 
 #include "CAIR.h"
 #include "CAIR_CML.h"
-#include <cmath> //for abs(), floor()
-#include <limits> //for max int
+#include <cmath> //for abs(), floor(), sqrt()
+#include <climits> //for INT_MAX
 #include <pthread.h>
 #include <semaphore.h>
-#include <stdint.h>
+#include <algorithm> //for sort()
+#include <atomic> //for the counters the threads spin on
+#include <thread> //for hardware_concurrency(), and the STD_THREADS backend
+#include <chrono> //for CAIR_Hybrid()'s time budget
+#ifdef _OPENMP
+#include <omp.h> //for the OPENMP backend
+#endif
+#ifdef __linux__
+#include <sched.h> //for pinning the threads to cores
+#endif
 
 using namespace std;
 
+//=========================================================================================================//
+//The forward energy cost planes. Each holds the additional cost of reaching a pixel from the up-left, up, or up-right
+//pixel in the row above. They are built once with the edge map and repaired next to the edges after each seam.
+struct Cost_Planes
+{
+	Cost_Planes() : Left( 1, 1 ), Up( 1, 1 ), Right( 1, 1 ) {}
+
+	CML_int Left;
+	CML_int Up;
+	CML_int Right;
+};
+
+//=========================================================================================================//
+//The shrunken map that CAIR_Pyramid() finds its paths on. Each block is the sum of the edges and weights of scale x scale
+//pixels, so Weights is all zeros. The energy map is kept up to date along with it, like the full one.
+struct Coarse_Planes
+{
+	Coarse_Planes() : Edge( 1, 1 ), Weights( 1, 1 ), Energy( 1, 1 ), Dir( 1, 1 ) {}
+
+	CML_int Edge;
+	CML_int Weights;
+	CML_int Energy;
+	CML_dir Dir;
+};
+
+//=========================================================================================================//
+//The widths CAIR_Ladder() wants, which CAIR_Remove() copies the image out to as it comes down to each one.
+struct Ladder_Rungs
+{
+	int count;
+	int next; //the next rung in order to be reached
+	int * order; //the rungs, widest first
+	int * widths;
+	CML_int ** D_Weights;
+	CML_color ** Dests;
+	bool (*CAIR_rung)(int);
+};
+
+//=========================================================================================================//
+//What the tasks of CAIR_Apply() work on. The map holds the old pixel each pixel came from, as y * width + x of the list's image.
+struct Plane_Apply
+{
+	CML_int * From; //the map before the current step
+	CML_int * To; //and after it
+	CML_int * Paths; //the step's paths, with all of their entries for a row of the map in a row
+	int count; //how many paths the step has
+	int change; //-1 when they are removed, 1 when they are added
+	CAIR_Plane * Planes;
+	unsigned char ** Old; //each plane as it was, row after row
+	int planes;
+};
+
+//=========================================================================================================//
+//One band of Remove_Bands(), carved with a context of its own. The band is the columns from start to start + Source.Width(),
+//and the first and last overlap of those are borrowed from its neighbors (fewer at the sides of the image).
+struct Band_Carve
+{
+	Band_Carve() : Source( 1, 1 ), Dest( 1, 1 ), Weights( 1, 1 ) {}
+
+	CAIR_Context * context;
+	CML_color Source;
+	CML_color Dest;
+	CML_int Weights;
+	int start;
+	int left; //borrowed columns on each side
+	int right;
+	int removes;
+	bool result;
+};
+
+//=========================================================================================================//
+//What the bands of Remove_Bands() share with the context that split them up, so that its cancel and its CAIR_callback still
+//work while they carve (see Cancelled() and Band_Progress()). removed is how many paths all of the bands have taken out so far.
+struct Band_Share
+{
+	CAIR_Context * parent;
+	bool (*CAIR_callback)(float);
+	int total_seams;
+	int seams_done;
+	std::atomic<int> removed;
+	std::atomic<bool> declined; //CAIR_callback returned false
+	pthread_mutex_t callback_lock; //only one band calls CAIR_callback at a time
+};
+
+//=========================================================================================================//
+//One pass of Resample_Image(), across the rows or down the columns. Each new pixel is made of count[i] old ones from first[i],
+//weighted out of 1 << RESAMPLE_BITS by weights[i * most].
+struct Resample_Pass
+{
+	CML_color * From;
+	CML_color * To;
+	int * first;
+	int * count;
+	int * weights;
+	int most;
+};
+
 //=========================================================================================================//
 //Thread parameters
 struct Thread_Params
@@ -200,133 +364,303 @@ struct Thread_Params
 	pthread_mutex_t * Mine; //used only for energy threads
 	pthread_mutex_t * Not_Mine;
 	CML_int * Energy_Map;
+	CML_dir * Dir; //which pixel above each pixel came from (-1, 0, 1)
 	CML_int * Edge;
 	CML_gray * Gray;
 	CML_int * Add_Weight;
 	CML_int * Sum_Weight;
+	Cost_Planes * Costs; //NULL when using backward energy
+	int batch_size; //number of paths in Path, row by row, when removing a batch (otherwise 1)
+	CML_int * Index; //the original column of each pixel, kept while finding paths to add (otherwise NULL)
+	int * Band; //the first and last row of each column to recalculate after a cross path (see Remove_Cross())
+	Plane_Apply * Apply; //what CAIR_Apply() is working on
+	Band_Carve * Carve; //the bands of Remove_Bands(), each task does top_y to bot_y of them
+	Resample_Pass * Resample; //what Resample_Image() is working on
 	//Thread Parameters
 	int top_y;
 	int bot_y;
 	int top_x;
 	int bot_x;
-	bool exit; //flag causing the thread to exit
 };
 
 //=========================================================================================================//
-//Thread Info
-Thread_Params * thread_info;
+//Where CAIR_Replay() is in its list of paths. Each path in the list is the coarse path for scale_x paths at full size
+//(see Refine_Path()). The list's image is width x height at the moment, and everything is turned the way the current step sees it.
+struct Seam_Replay
+{
+	CAIR_Seam_List * Seams;
+	int next; //the next path in the list
+	int scale_x;
+	int scale_y;
+	int width;
+	int height;
+};
+
+//=========================================================================================================//
+//The limits CAIR_Hybrid() carves within. CAIR_Remove() stops before the first path that would go over any of them.
+struct Carve_Budget
+{
+	int seams; //how many more paths may be removed, -1 for no limit
+	bool timed;
+	std::chrono::steady_clock::time_point deadline;
+	int payoff; //stop once a path costs this percent of an average column, 0 for no limit
+	bool stopped; //set when a limit was reached
+};
+
+//=========================================================================================================//
+//Everything one run of CAIR needs to itself: the settings, the threads, and what they use to talk to each other.
+//Each context has its own threads, so separate contexts can resize separate images at the same time.
+struct CAIR_Context
+{
+	CAIR_Context();
+
+	//Strip Info, what each task works on
+	Thread_Params * thread_info;
+	int num_strips; //how many the current image is split into
+	int strip_room; //how many thread_info and remove_done have room for
+
+	//The worker threads, see Run_Tasks()
+	pthread_t * workers;
+	int num_threads; //what CAIR_Threads() asked for, zero to pick for each image (see Pick_Threads())
+	int pool_threads; //how many workers are running, zero when they're shut down
+	int run_threads; //how many threads the current image is split between, zero when it's done on the calling thread
+	bool pooled; //the current image runs on our pool of workers, otherwise Start_Tasks() runs each set to the end (see Run_Backend())
+	bool exit; //flag causing the workers to exit
+	bool pin; //what CAIR_Affinity() asked for
+	bool pool_pinned; //the running workers are pinned to cores, and always take the same strips
+	int * worker_next; //when pinned, the next task each worker takes
+	int workers_up; //hands each worker its number as it starts up
+
+	//The current set of tasks. Each is run as task( context, num ), for num from 0 to task_count - 1.
+	void (*task)( CAIR_Context * context, int num );
+	int task_count;
+	int task_next; //the next one nobody has taken yet
+	std::atomic<int> task_left; //how many are not finished
+	std::atomic<int> task_round; //goes up by one for every set, so a waiting thread can tell when the next one is out
+	int sleepers; //workers asleep on task_ready
+	bool finish_asleep; //Finish_Tasks() is asleep on task_done
+	int spin_count; //how long to check on something before going to sleep on it (see SPIN_COUNT)
+	pthread_mutex_t task_lock; //guards all of the task stuff (the atomics are only read without it)
+	pthread_cond_t task_ready; //a new set was handed out
+	pthread_cond_t task_done; //the last one of the set is finished
+
+	//What runs the tasks, see CAIR_Backend() and CAIR_Executor()
+	CAIR_backend backend;
+	CAIR_executor executor;
+	void * executor_host;
+	int executor_threads;
+
+	//Batch removal settings, see CAIR_Batch()
+	int batch_size;
+	int batch_quality;
+
+	//How CAIR_Add() enlarges, see CAIR_Add_Mode()
+	CAIR_add_mode add_mode;
+
+	//The coarse to fine path search, see CAIR_Pyramid() (1 when off)
+	int pyramid_scale;
+
+	//Banded removal, see CAIR_Bands() (1 when off)
+	int split_bands;
+	int band_overlap;
+
+	//The local path search, see CAIR_Local() (a reach of 0 when off)
+	int local_reach;
+	int local_threshold;
+
+	//The paths being recorded by CAIR_Seams() and played back by CAIR_Replay(), NULL otherwise
+	CAIR_Seam_List * record;
+	Seam_Replay * replay;
+
+	//The limits CAIR_Hybrid() is carving within, NULL otherwise
+	Carve_Budget * budget;
+
+	//Set by CAIR_Cancel(). The long steps check it every row and stop early, and CAIR() gives up at the next seam.
+	//Always read through Cancelled(), which also looks at the context that split us up into bands.
+	std::atomic<bool> cancel;
+
+	//The bands of Remove_Bands() that this context is carving one of, NULL otherwise
+	Band_Share * share;
+
+	//Thread Semaphores
+	sem_t * remove_done; //one for each strip, lets Remove_Path() pick up each strip as soon as it is finished
+	sem_t energy_sem[2]; //locks_done, good_to_go
+
+	//energy thread mutexes. these arrays will be created in Resize_Threads()
+	pthread_mutex_t * Left_Mutexes;
+	pthread_mutex_t * Right_Mutexes;
+	int mutex_height;
+};
 
-//Thread Handles
-pthread_t * remove_threads;
-pthread_t * edge_threads;
-pthread_t * gray_threads;
-pthread_t * add_threads;
-pthread_t energy_threads[2]; //these are limited to only two
-int num_threads = CAIR_NUM_THREADS;
+CAIR_Context::CAIR_Context()
+{
+	thread_info = NULL;
+	num_strips = 0;
+	strip_room = 0;
+	workers = NULL;
+	num_threads = CAIR_NUM_THREADS;
+	pool_threads = 0;
+	run_threads = 0;
+	pooled = false;
+	backend = PTHREADS;
+	executor = NULL;
+	executor_host = NULL;
+	executor_threads = 0;
+	exit = false;
+	pin = false;
+	pool_pinned = false;
+	worker_next = NULL;
+	workers_up = 0;
+	task = NULL;
+	task_count = 0;
+	task_next = 0;
+	task_left = 0;
+	task_round = 0;
+	sleepers = 0;
+	finish_asleep = false;
+	spin_count = 0;
+	batch_size = 1;
+	batch_quality = 0;
+	add_mode = WEIGHTED;
+	pyramid_scale = 1;
+	split_bands = 1;
+	band_overlap = 0;
+	local_reach = 0;
+	local_threshold = 0;
+	record = NULL;
+	budget = NULL;
+	replay = NULL;
+	cancel = false;
+	share = NULL;
+	remove_done = NULL;
+	Left_Mutexes = NULL;
+	Right_Mutexes = NULL;
+	mutex_height = 0;
+}
+
+//=========================================================================================================//
+//Returns true once the work on this context should stop: it was cancelled, or it's carving a band (see Remove_Bands()) and the
+//context that split it up was cancelled, or that one's CAIR_callback said to stop.
+inline bool Cancelled( CAIR_Context * context )
+{
+	if( context->cancel == true )
+	{
+		return true;
+	}
+	return ( context->share != NULL ) && ( (context->share->declined == true) || (context->share->parent->cancel == true) );
+}
 
-//Thread Semaphores
-sem_t remove_sem[3]; //start, edge_start, finish
-sem_t add_sem[4]; //add_start, start, edge_start, finish
-sem_t edge_sem[2]; //start, finish
-sem_t gray_sem[2]; //start, finish
-sem_t energy_sem[5]; //start_left, start_right, locks_done, good_to_go, finish
+//The context used by the calls that don't take one
+CAIR_Context default_context;
 
 //early declarations on the threading functions
-void Startup_Threads();
-void Resize_Threads( int height );
-void Shutdown_Threads();
-//energy thread mutexes. these arrays will be created in Resize_Threads()
-pthread_mutex_t * Left_Mutexes = NULL;
-pthread_mutex_t * Right_Mutexes = NULL;
-int mutex_height = 0;
+void Startup_Threads( CAIR_Context * context, int width, int height );
+void Resize_Threads( CAIR_Context * context, int height );
+void Shutdown_Threads( CAIR_Context * context );
+void Start_Tasks( CAIR_Context * context, void (*task)( CAIR_Context * context, int num ), int count );
+void Finish_Tasks( CAIR_Context * context );
+void Run_Tasks( CAIR_Context * context, void (*task)( CAIR_Context * context, int num ), int count );
+inline void Spin_Wait( CAIR_Context * context, sem_t * sem );
+inline void Spin_Lock( CAIR_Context * context, pthread_mutex_t * mutex );
+//early declaration for the forward energy costs, which are repaired by the edge threads
+inline void Forward_Cost_Row( CML_int * Edge, Cost_Planes * Costs, int y, int min_x, int max_x );
+inline void Repair_Costs( CML_int * Edge, Cost_Planes * Costs, int * Path, int y, int width );
+//early declaration for the paper-style enlarging, which uses CAIR_Remove()
+bool CAIR_Add_Seams( CAIR_Context * context, CML_color * Source, CML_int * Weights, int goal_x, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done );
+//early declarations for recording and playing back the paths, which both adding and removing do
+void Record_Path( CAIR_Seam_List * Seams, int * Path, int length, int stride );
+void Next_Seam( Seam_Replay * replay, int * Path );
+int Refine_Path( CML_int * Edge, CML_int * Weights, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, CAIR_energy ener, int * Coarse_Path, int scale_x, int scale_y, int coarse_width, int coarse_height, int removed, int * Path );
+//early declaration for the progress of CAIR_Bands(), which CAIR_Remove() reports
+void Band_Progress( CAIR_Context * context );
 
 //=========================================================================================================//
 #define MIN(X,Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X,Y) ((X) > (Y) ? (X) : (Y))
 
+//The energy threads can be a row apart from each other, so three rows are the least a rolling energy map can get by with.
+#define ROLLING_ROWS 3
+
+//How many times a thread checks on what it's waiting for before going to sleep. Most of the steps for a seam take only a few
+//microseconds, so the wait is usually over long before the kernel could put a thread to sleep and wake it back up.
+//This is only done with more than one core, otherwise spinning just holds up the thread we're waiting on.
+#define SPIN_COUNT 4000
+
+//The fewest pixels worth handing each thread (128x128). Below two threads' worth, the image is done on the calling thread alone,
+//since waking the workers up for every seam would cost more than they could save.
+#define MIN_THREAD_PIXELS 16384
+
+//Each stage is split into this many strips for every thread, so a slow strip doesn't leave the other threads waiting at the end.
+#define STRIPS_PER_THREAD 4
+
+//A batch has to redo the grayscale, edges, and energy from scratch, which costs about as much as removing this many paths one at a time.
+#define BATCH_MIN 8
+
+//What the cells outside the band of a refined path start with, so no path can come through them (see Band_Path()).
+//Low enough that the edges and weights added to it down the image don't overflow, so large weights can go past it.
+#define BAND_WALL (INT_MAX / 4)
+
+//The size of the shrunken copy CAIR_Transport() plans on (64x64). The plan takes two paths for every pair of counts on it.
+//Smaller images are still shrunk by at least PLAN_MIN_SCALE each way, otherwise the plan could cost more than the resize.
+#define PLAN_PIXELS 4096
+#define PLAN_MIN_SCALE 4
+
+//The fixed point the resampler's weights are in, which leaves room for a weight times 255 to add up without overflowing.
+#define RESAMPLE_BITS 14
+
 //=========================================================================================================//
 //==                                          G R A Y S C A L E                                          ==//
 //=========================================================================================================//
 
 //=========================================================================================================//
 //Performs a RGB->YUV type conversion (we only want Y', the luma)
+//Integer division is the same as the old floor() of the double, without the conversions.
 inline CML_byte Grayscale_Pixel( CML_RGBA * pixel )
 {
-	return (CML_byte)floor( ( 299 * pixel->red +
-							  587 * pixel->green +
-							  114 * pixel->blue ) / 1000.0 );
+	return (CML_byte)( ( 299 * pixel->red +
+						 587 * pixel->green +
+						 114 * pixel->blue ) / 1000 );
 }
 
 //=========================================================================================================//
-//Our thread function for the Grayscale
-void * Gray_Quadrant( void * id )
+//Our task function for the Grayscale, one strip of the image
+void Gray_Task( CAIR_Context * context, int num )
 {
-	int num = (uintptr_t)id;
-
-	while( true )
-	{
-		//wait for the thread to get a signal to start
-		sem_wait( &(gray_sem[0]) );
-
-		//get updated parameters
-		Thread_Params gray_area = thread_info[num];
-
-		if( gray_area.exit == true )
-		{
-			//thread is exiting
-			break;
-		}
+	Thread_Params gray_area = context->thread_info[num];
 
-		CML_byte gray = 0;
+	CML_byte gray = 0;
 
-		for( int y = gray_area.top_y; y < gray_area.bot_y; y++ )
+	for( int y = gray_area.top_y; (y < gray_area.bot_y) && (Cancelled( context ) == false); y++ )
+	{
+		for( int x = 0; x < (*(gray_area.Source)).Width(); x++ )
 		{
-			for( int x = 0; x < (*(gray_area.Source)).Width(); x++ )
-			{
-				gray = Grayscale_Pixel( &(*(gray_area.Source))(x,y) );
+			gray = Grayscale_Pixel( &(*(gray_area.Source))(x,y) );
 
-				(*(gray_area.Gray))(x,y) = gray;
-			}
+			(*(gray_area.Gray))(x,y) = gray;
 		}
-
-		//signal we're done
-		sem_post( &(gray_sem[1]) );
 	}
-
-	return NULL;
-} //end Gray_Quadrant()
+} //end Gray_Task()
 
 //=========================================================================================================//
 //Sort-of does a RGB->YUV conversion (actually, just RGB->Y)
-//Multi-threaded with each thread getting a stirp across the image.
-void Grayscale_Image( CML_color * Source, CML_gray * Dest )
+//Multi-threaded with each task getting a stirp across the image.
+void Grayscale_Image( CAIR_Context * context, CML_color * Source, CML_gray * Dest )
 {
-	int thread_height = (*Source).Height() / num_threads;
+	int thread_height = (*Source).Height() / context->num_strips;
 
 	//setup parameters
-	for( int i = 0; i < num_threads; i++ )
-	{
-		thread_info[i].Source = Source;
-		thread_info[i].Gray = Dest;
-		thread_info[i].top_y = i * thread_height;
-		thread_info[i].bot_y = thread_info[i].top_y + thread_height;
-	}
-
-	//have the last thread pick up the slack
-	thread_info[num_threads-1].bot_y = (*Source).Height();
-
-	//startup the threads
-	for( int i = 0; i < num_threads; i++ )
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		sem_post( &(gray_sem[0]) );
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].Gray = Dest;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
 
-	//now wait for them to come back to us
-	for( int i = 0; i < num_threads; i++ )
-	{
-		sem_wait( &(gray_sem[1]) );
-	}
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = (*Source).Height();
 
+	Run_Tasks( context, Gray_Task, context->num_strips );
 } //end Grayscale_Image()
 
 //=========================================================================================================//
@@ -423,49 +757,38 @@ int Convolve_Pixel( CML_gray * Source, int x, int y, edge_safe safety, CAIR_conv
 }
 
 //=========================================================================================================//
-//The thread function, splitting the image into strips
-void * Edge_Quadrant( void * id )
+//The task function, one strip of the image
+void Edge_Task( CAIR_Context * context, int num )
 {
-	int num = (uintptr_t)id;
+	Thread_Params edge_area = context->thread_info[num];
 
-	while( true )
+	for( int y = edge_area.top_y; (y < edge_area.bot_y) && (Cancelled( context ) == false); y++ )
 	{
-		sem_wait( &(edge_sem[0]) );
+		//left most edge
+		(*(edge_area.Edge))(0,y) = Convolve_Pixel( edge_area.Gray, 0, y, SAFE, edge_area.conv );
 
-		//get updated parameters
-		Thread_Params edge_area = thread_info[num];
-
-		if( edge_area.exit == true )
+		//fill in the middle
+		for( int x = 1; x < (*(edge_area.Gray)).Width() - 1; x++ )
 		{
-			//thread is exiting
-			break;
+			(*(edge_area.Edge))(x,y) = Convolve_Pixel( edge_area.Gray, x, y, UNSAFE, edge_area.conv );
 		}
 
-		for( int y = edge_area.top_y; y < edge_area.bot_y; y++ )
-		{
-			//left most edge
-			(*(edge_area.Edge))(0,y) = Convolve_Pixel( edge_area.Gray, 0, y, SAFE, edge_area.conv );
-
-			//fill in the middle
-			for( int x = 1; x < (*(edge_area.Gray)).Width() - 1; x++ )
-			{
-				(*(edge_area.Edge))(x,y) = Convolve_Pixel( edge_area.Gray, x, y, UNSAFE, edge_area.conv );
-			}
+		//right most edge
+		(*(edge_area.Edge))((*(edge_area.Gray)).Width()-1,y) = Convolve_Pixel( edge_area.Gray, (*(edge_area.Gray)).Width()-1, y, SAFE, edge_area.conv);
 
-			//right most edge
-			(*(edge_area.Edge))((*(edge_area.Gray)).Width()-1,y) = Convolve_Pixel( edge_area.Gray, (*(edge_area.Gray)).Width()-1, y, SAFE, edge_area.conv);
+		//the forward costs need the edge row above, so the top of our strip is left for Edge_Detect()
+		if( (edge_area.Costs != NULL) && (y > edge_area.top_y) )
+		{
+			Forward_Cost_Row( edge_area.Edge, edge_area.Costs, y, 0, (*(edge_area.Edge)).Width() - 1 );
 		}
-
-		//signal we're done
-		sem_post( &(edge_sem[1]) );
 	}
-
-	return NULL;
 }
 
 //=========================================================================================================//
 //Performs full edge detection on Source with one of the kernels.
-void Edge_Detect( CML_gray * Source, CML_int * Dest, CAIR_convolution conv )
+//If Costs is not NULL, the forward energy cost planes are also built from the finished edge map. They must already be
+//the same size as Dest (see Setup_Costs()).
+void Edge_Detect( CAIR_Context * context, CML_gray * Source, CML_int * Dest, CAIR_convolution conv, Cost_Planes * Costs )
 {
 	//There is no easy solution to the boundries. Calling the same boundry pixel to convolve itself against seems actually better
 	//than padding the image with zeros or 255's.
@@ -473,26 +796,25 @@ void Edge_Detect( CML_gray * Source, CML_int * Dest, CAIR_convolution conv )
 	//The only "good" solution is to have the entire one-pixel wide edge not included in the edge detected image.
 	//This would reduce the size of the image by 2 pixels in both directions, something that is unacceptable here.
 
-	int thread_height = (*Source).Height() / num_threads;
+	//the top and bottom rows are done separately, so the strips only split up the rows between them
+	int thread_height = ((*Source).Height() - 2) / context->num_strips;
 
 	//setup parameters
-	for( int i = 0; i < num_threads; i++ )
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		thread_info[i].Gray = Source;
-		thread_info[i].Edge = Dest;
-		thread_info[i].top_y = (i * thread_height) + 1; //handle very top row down below
-		thread_info[i].bot_y = thread_info[i].top_y + thread_height;
-		thread_info[i].conv = conv;
+		context->thread_info[i].Gray = Source;
+		context->thread_info[i].Edge = Dest;
+		context->thread_info[i].top_y = (i * thread_height) + 1; //handle very top row down below
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
+		context->thread_info[i].conv = conv;
+		context->thread_info[i].Costs = Costs;
 	}
 
-	//have the last thread pick up the slack
-	thread_info[num_threads-1].bot_y = (*Source).Height() - 1; //handle very bottom row down below
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = (*Source).Height() - 1; //handle very bottom row down below
 
-	//create the threads
-	for( int i = 0; i < num_threads; i++ )
-	{
-		sem_post( &(edge_sem[0]) );
-	}
+	//hand out the strips
+	Start_Tasks( context, Edge_Task, context->num_strips );
 
 	//while those are running we can go back and do the boundry pixels with the extra safety checks
 	for( int x = 0; x < (*Source).Width(); x++ )
@@ -502,9 +824,22 @@ void Edge_Detect( CML_gray * Source, CML_int * Dest, CAIR_convolution conv )
 	}
 
 	//now wait on them
-	for( int i = 0; i < num_threads; i++ )
+	Finish_Tasks( context );
+
+	if( Costs != NULL )
 	{
-		sem_wait( &(edge_sem[1]) );
+		//now that all of the edges are in, fill in the cost rows the strips couldn't do (the top row never uses forward costs)
+		for( int i = 0; i < context->num_strips; i++ )
+		{
+			if( context->thread_info[i].top_y < context->thread_info[i].bot_y )
+			{
+				Forward_Cost_Row( Dest, Costs, context->thread_info[i].top_y, 0, (*Dest).Width() - 1 );
+			}
+		}
+		if( (*Dest).Height() > 1 )
+		{
+			Forward_Cost_Row( Dest, Costs, (*Dest).Height() - 1, 0, (*Dest).Width() - 1 );
+		}
 	}
 
 } //end Edge_Detect()
@@ -514,78 +849,127 @@ void Edge_Detect( CML_gray * Source, CML_int * Dest, CAIR_convolution conv )
 //=========================================================================================================//
 
 //=========================================================================================================//
-//Simple fuction returning the minimum of three values.
-inline int min_of_three( int x, int y, int z )
+//This walks the minimum energy path back up from the given start point (min_x), following the directions the energy map chose.
+//Note: Path better be of proper size.
+void Generate_Path( CML_dir * Dir, int min_x, int * Path )
 {
-	int min = y;
-
-	if( x < min )
-	{
-		min = x;
-	}
-	if( z < min )
+	int x = min_x;
+	for( int y = (*Dir).Height() - 1; y > 0; y-- ) //builds from bottom up
 	{
-		return z;
+		Path[y] = x;
+		x += (*Dir)(x,y);
 	}
+	Path[0] = x;
+}
+
+//=========================================================================================================//
+//Forward energy cost functions. These are additional energy values for the left, up, and right seam paths.
+//See the paper "Improved Seam Carving for Video Retargeting" by Michael Rubinstein, Ariel Shamir, and Shai  Avidan.
+inline int Forward_CostL( CML_int * Edge, int x, int y )
+{
+	return (abs((*Edge)(x+1,y) - (*Edge)(x-1,y)) + abs((*Edge)(x,y-1) - (*Edge)(x-1,y)));
+}
+
+inline int Forward_CostU( CML_int * Edge, int x, int y )
+{
+	return (abs((*Edge)(x+1,y) - (*Edge)(x-1,y)));
+}
 
-	return min;
+inline int Forward_CostR( CML_int * Edge, int x, int y )
+{
+	return (abs((*Edge)(x+1,y) - (*Edge)(x-1,y)) + abs((*Edge)(x,y-1) - (*Edge)(x+1,y)));
 }
 
 //=========================================================================================================//
-//Get the value from the integer matrix, return a large value if out-of-bounds in the x-direction.
-inline int Get_Max( CML_int * Energy, int x, int y )
+//Fills in the cost planes for row y from min_x to max_x, inclusive. The boundary columns and the top row
+//never use the forward costs in the energy map, so they are skipped.
+inline void Forward_Cost_Row( CML_int * Edge, Cost_Planes * Costs, int y, int min_x, int max_x )
 {
-	if( ( x < 0 ) || ( x >= (*Energy).Width() ) )
-	{
-		return std::numeric_limits<int>::max();
-	}
-	else
+	min_x = MAX( min_x, 1 );
+	max_x = MIN( max_x, (*Edge).Width() - 2 );
+
+	for( int x = min_x; x <= max_x; x++ )
 	{
-		return (*Energy).Get( x, y );
+		(*Costs).Left(x,y) = Forward_CostL( Edge, x, y );
+		(*Costs).Up(x,y) = Forward_CostU( Edge, x, y );
+		(*Costs).Right(x,y) = Forward_CostR( Edge, x, y );
 	}
 }
 
 //=========================================================================================================//
-//This calculates a minimum energy path from the given start point (min_x) and the energy map.
-//Note: Path better be of proper size.
-void Generate_Path( CML_int * Energy, int min_x, int * Path )
+//Repairs the cost row y after Path was removed or added. Only the costs around the path, here and in the row above, can change.
+//width is the new width of the image, since the edge map may not have been resized yet.
+inline void Repair_Costs( CML_int * Edge, Cost_Planes * Costs, int * Path, int y, int width )
 {
-	int min;
-	int x = min_x;
-	for( int y = (*Energy).Height() - 1; y >= 0; y-- ) //builds from bottom up
-	{
-		min = x; //assume the minimum is straight up
-
-		if( Get_Max( Energy, x-1, y ) < Get_Max( Energy, min, y ) ) //check to see if min is up-left
-		{
-			min = x - 1;
-		}
-		if( Get_Max( Energy, x+1, y ) < Get_Max( Energy, min, y) ) //up-right
-		{
-			min = x + 1;
-		}
-		
-		Path[y] = min;
-		x = min;
-	}
+	int min_x = MIN( Path[y], Path[y-1] ) - 4;
+	int max_x = MAX( Path[y], Path[y-1] ) + 4;
+	Forward_Cost_Row( Edge, Costs, y, min_x, MIN( max_x, width - 2 ) );
 }
 
 //=========================================================================================================//
-//Forward energy cost functions. These are additional energy values for the left, up, and right seam paths.
-//See the paper "Improved Seam Carving for Video Retargeting" by Michael Rubinstein, Ariel Shamir, and Shai  Avidan.
-inline int Forward_CostL( CML_int * Edge, int x, int y )
+//Sizes the cost planes for an edge map of the given size. Returns NULL for backward energy, since it doesn't need them.
+Cost_Planes * Setup_Costs( Cost_Planes * Costs, CAIR_energy ener, int width, int height )
 {
-	return (abs((*Edge)(x+1,y) - (*Edge)(x-1,y)) + abs((*Edge)(x,y-1) - (*Edge)(x-1,y)));
+	if( ener == BACKWARD )
+	{
+		return NULL;
+	}
+
+	(*Costs).Left.D_Resize( width, height );
+	(*Costs).Up.D_Resize( width, height );
+	(*Costs).Right.D_Resize( width, height );
+	return Costs;
 }
 
-inline int Forward_CostU( CML_int * Edge, int x, int y )
+//=========================================================================================================//
+//Returns the energy of the boundry pixel x (the first or last column) of row y, using Prev as the energy of the row above.
+//Being the edge value, forward energy would have no benefit here, and hence is not checked.
+inline int Energy_Boundry( Thread_Params * energy_area, int x, int y, int * Prev )
 {
-	return (abs((*Edge)(x+1,y) - (*Edge)(x-1,y)));
+	int other = ( x == 0 ) ? 1 : x - 1; //the only neighbor above
+	(*(energy_area->Dir))(x,y) = ( Prev[other] < Prev[x] ) ? other - x : 0;
+	return MIN( Prev[x], Prev[other] ) + (*(energy_area->Edge))(x,y) + (*(energy_area->D_Weights))(x,y);
 }
 
-inline int Forward_CostR( CML_int * Edge, int x, int y )
+//=========================================================================================================//
+//Calculates the energy of row y from min_x to max_x into Row, using Prev as the energy of the row above. The direction
+//of each chosen pixel goes straight into the Dir matrix. The outside boundary pixels are left to the caller.
+//Everything is pulled out into row pointers so the add-and-min is a simple loop the compiler can vectorize.
+//Ties go to straight up, then to the up-left.
+inline void Energy_Row( Thread_Params * energy_area, int y, int min_x, int max_x, int * Prev, int * Row )
 {
-	return (abs((*Edge)(x+1,y) - (*Edge)(x-1,y)) + abs((*Edge)(x,y-1) - (*Edge)(x+1,y)));
+	int * Weights = &(*(energy_area->D_Weights))(0,y);
+	signed char * Dir = &(*(energy_area->Dir))(0,y);
+
+	if( energy_area->ener == BACKWARD )
+	{
+		int * Edge = &(*(energy_area->Edge))(0,y);
+
+		for( int x = min_x; x <= max_x; x++ )
+		{
+			//grab the minimum of straight up, up left, or up right
+			int up = MIN( Prev[x-1], Prev[x] );
+			signed char dir = ( Prev[x-1] < Prev[x] ) ? -1 : 0;
+			Dir[x] = ( Prev[x+1] < up ) ? 1 : dir;
+			Row[x] = MIN( up, Prev[x+1] ) + Edge[x] + Weights[x];
+		}
+	}
+	else
+	{
+		int * Left = &(*(energy_area->Costs)).Left(0,y);
+		int * Up = &(*(energy_area->Costs)).Up(0,y);
+		int * Right = &(*(energy_area->Costs)).Right(0,y);
+
+		for( int x = min_x; x <= max_x; x++ )
+		{
+			int left = Prev[x-1] + Left[x];
+			int right = Prev[x+1] + Right[x];
+			int up = MIN( left, Prev[x] + Up[x] );
+			signed char dir = ( left < Prev[x] + Up[x] ) ? -1 : 0;
+			Dir[x] = ( right < up ) ? 1 : dir;
+			Row[x] = MIN( up, right ) + Weights[x];
+		}
+	}
 }
 
 //=========================================================================================================//
@@ -618,310 +1002,338 @@ inline int Forward_CostR( CML_int * Edge, int x, int y )
 //The thread responsible for those values must lock those mutexes first before the other thread can try.
 //This limits one thread only getting about 2 rows ahead of the other thread before it finds itself blocked.
 //=========================================================================================================//
-void * Energy_Left( void * id )
+void Energy_Left( CAIR_Context * context, int num )
 {
-	int num = (uintptr_t)id;
-	int energy = 0;// current calculated enery
-	int min_x = 0, max_x = 0;
+	//get the update parameters
+	Thread_Params energy_area = context->thread_info[num];
 
-	while( true )
+	//lock our mutexes
+	for( int i = 0; i < context->mutex_height; i++ )
 	{
-		sem_wait( &(energy_sem[0]) );
+		pthread_mutex_lock( &(energy_area.Mine)[i] );
+	}
 
-		//get the update parameters
-		Thread_Params energy_area = thread_info[num];
+	//signal we are done
+	sem_post( &(context->energy_sem[0]) );
 
-		if( energy_area.exit == true )
-		{
-			//thread is exiting
-			break;
-		}
+	//wait until we are good to go
+	Spin_Wait( context, &(context->energy_sem[1]) );
 
-		int * Path = energy_area.Path;
+	//set the first row with the correct energy
+	int * Cur = &(*(energy_area.Energy_Map))(0,0);
+	for( int x = energy_area.top_x; x <= energy_area.bot_x; x++ )
+	{
+		Cur[x] = (*(energy_area.Edge))(x,0) + (*(energy_area.D_Weights))(x,0);
+	}
 
-		if( Path == NULL )
-		{
-			//calculate full region
-			min_x = energy_area.top_x;
-			max_x = energy_area.bot_x;
-		}
-		else
-		{
-			//restrict calculation tree based on path location
-			min_x = MAX( Path[0]-3, energy_area.top_x );
-			max_x = MIN( Path[0]+2, energy_area.bot_x );	
-		}
+	//now signal that one is done
+	pthread_mutex_unlock( &(energy_area.Mine)[0] );
 
-		//lock our mutexes
-		for( int i = 0; i < mutex_height; i++ )
-		{
-			pthread_mutex_lock( &(energy_area.Mine)[i] );
-		}
+	//the map is either the full height, or just a few rolling rows
+	int map_height = (*(energy_area.Energy_Map)).Height();
 
-		//signal we are done
-		sem_post( &(energy_sem[2]) );
+	for( int y = 1; y < (*(energy_area.Edge)).Height(); y++ )
+	{
+		int * Prev = Cur;
+		Cur = &(*(energy_area.Energy_Map))(0,y % map_height);
 
-		//wait until we are good to go
-		sem_wait( &(energy_sem[3]) );
+		//get access to the bad pixel (the one not maintained by us)
+		Spin_Lock( context, &(energy_area.Not_Mine)[y-1] );
+		pthread_mutex_unlock( &(energy_area.Not_Mine)[y-1] );
 
-		//set the first row with the correct energy
-		for( int x = min_x; x <= max_x; x++ )
+		//once cancelled, only the locks are kept going, so the right isn't left waiting on us
+		if( Cancelled( context ) == false )
 		{
-			(*(energy_area.Energy_Map))(x,0) = (*(energy_area.Edge))(x,0) + (*(energy_area.D_Weights))(x,0);
+			Cur[energy_area.top_x] = Energy_Boundry( &energy_area, energy_area.top_x, y, Prev );
+			Energy_Row( &energy_area, y, energy_area.top_x + 1, energy_area.bot_x, Prev, Cur );
 		}
 
-		//now signal that one is done
-		pthread_mutex_unlock( &(energy_area.Mine)[0] );
+		pthread_mutex_unlock( &(energy_area.Mine)[y] );
+	}
+} //end Energy_Left()
 
-		for( int y = 1; y < (*(energy_area.Edge)).Height(); y++ )
-		{
-			min_x=MAX( min_x-1, energy_area.top_x );
-			max_x=MIN( max_x+1, energy_area.bot_x );
+//=========================================================================================================//
+void Energy_Right( CAIR_Context * context, int num )
+{
+	//get the update parameters
+	Thread_Params energy_area = context->thread_info[num];
 
-			for( int x = min_x; x <= max_x; x++ ) 
-			{
-				if( x == energy_area.top_x )
-				{
-					//being the edge value, forward energy would have no benefit here, and hence is not checked
-					energy = MIN( (*(energy_area.Energy_Map))(energy_area.top_x,y-1), (*(energy_area.Energy_Map))(energy_area.top_x+1,y-1) )
-							  + (*(energy_area.Edge))(energy_area.top_x,y) + (*(energy_area.D_Weights))(energy_area.top_x,y);
-				}
-				else
-				{	    
-					if( x == energy_area.bot_x )//get access to the bad pixel (the one not maintained by us)
-					{
-						pthread_mutex_lock( &(energy_area.Not_Mine)[y-1] );
-						pthread_mutex_unlock( &(energy_area.Not_Mine)[y-1] );
-					}
+	//lock our mutexes
+	for( int i = 0; i < context->mutex_height; i++ )
+	{
+		pthread_mutex_lock( &(energy_area.Mine)[i] );
+	}
 
-					if( energy_area.ener == BACKWARD )
-					{
-						//grab the minimum of straight up, up left, or up right
-						energy = min_of_three( (*(energy_area.Energy_Map))(x-1,y-1),
-											   (*(energy_area.Energy_Map))(x,y-1),
-											   (*(energy_area.Energy_Map))(x+1,y-1) )
-								 + (*(energy_area.Edge))(x,y) + (*(energy_area.D_Weights))(x,y);
-					}
-					else
-					{
-						energy = min_of_three( (*(energy_area.Energy_Map))(x-1,y-1) + Forward_CostL(energy_area.Edge,x,y),
-											   (*(energy_area.Energy_Map))(x,y-1) + Forward_CostU(energy_area.Edge,x,y),
-											   (*(energy_area.Energy_Map))(x+1,y-1) + Forward_CostR(energy_area.Edge,x,y) )
-								 + (*(energy_area.D_Weights))(x,y);
-					}
-				}
+	//signal we are done
+	sem_post( &(context->energy_sem[0]) );
 
-				//now we have the energy
-				if((*(energy_area.Energy_Map))(x,y) == energy && Path != NULL )
-				{
-					if(x == min_x && Path[y]>min_x+3 )min_x++;
-					if(x == max_x && Path[y]<max_x-2 )max_x--;
-				}
-				else
-				{ //set the energy of the pixel
-					 (*(energy_area.Energy_Map))(x,y) = energy;
-				} 			
-			}
-			pthread_mutex_unlock( &(energy_area.Mine)[y] );
+	//wait until we are good to go
+	Spin_Wait( context, &(context->energy_sem[1]) );
+
+	//set the first row with the correct energy
+	int * Cur = &(*(energy_area.Energy_Map))(0,0);
+	for( int x = energy_area.top_x; x <= energy_area.bot_x; x++ )
+	{
+		Cur[x] = (*(energy_area.Edge))(x,0) + (*(energy_area.D_Weights))(x,0);
+	}
+
+	//now signal that one is done
+	pthread_mutex_unlock( &(energy_area.Mine)[0] );
+
+	//the map is either the full height, or just a few rolling rows
+	int map_height = (*(energy_area.Energy_Map)).Height();
+
+	for( int y = 1; y < (*(energy_area.Edge)).Height(); y++ )
+	{
+		int * Prev = Cur;
+		Cur = &(*(energy_area.Energy_Map))(0,y % map_height);
+
+		//get access to the bad pixel (the one not maintained by us)
+		Spin_Lock( context, &(energy_area.Not_Mine)[y-1] );
+		pthread_mutex_unlock( &(energy_area.Not_Mine)[y-1] );
+
+		if( Cancelled( context ) == false )
+		{
+			Energy_Row( &energy_area, y, energy_area.top_x, energy_area.bot_x - 1, Prev, Cur );
+			Cur[energy_area.bot_x] = Energy_Boundry( &energy_area, energy_area.bot_x, y, Prev );
 		}
 
-		//signal we're done
-		sem_post( &(energy_sem[4]) );
-	} //end while(true)
+		pthread_mutex_unlock( &(energy_area.Mine)[y] );// could be put in the loop for faster a releasing of the mutex, but to be VERY carefull (use a boolean on the previous lock) 
+	}
+} //end Energy_Right()
 
-	return NULL;
-} //end Energy_Left()
+//=========================================================================================================//
+//The energy map is always two tasks, the left (0) and the right (1), which need to run side by side.
+void Energy_Task( CAIR_Context * context, int num )
+{
+	if( num == 0 )
+	{
+		Energy_Left( context, num );
+	}
+	else
+	{
+		Energy_Right( context, num );
+	}
+}
 
 //=========================================================================================================//
-void * Energy_Right( void * id )
+//Updates row y of the energy map after Path was removed or added. Row is scratch space as wide as the map.
+//changed_min and changed_max come in as the part of the row above that changed value, and go out as the part of this row.
+void Energy_Update_Row( Thread_Params * energy_area, int * Path, int y, int width, int * Row, int * changed_min, int * changed_max )
 {
-	int num = (uintptr_t)id;
-	int energy = 0;// current calculated enery
-	int min_x = 0, max_x = 0;
+	int * Cur = &(*(energy_area->Energy_Map))(0,y);
 
-	while( true )
+	//the area around the path, which covers the changed edges, costs, and the shift between the rows
+	int min_x = Path[y] - 4;
+	int max_x = Path[y] + 4;
+	if( y > 0 )
 	{
-		sem_wait( &(energy_sem[1]) );
+		min_x = MIN( Path[y], Path[y-1] ) - 4;
+		max_x = MAX( Path[y], Path[y-1] ) + 4;
+	}
 
-		//get the update parameters
-		Thread_Params energy_area = thread_info[num];
-		int * Path = energy_area.Path;
+	//plus anyone who could have picked a changed pixel from above
+	if( *changed_min <= *changed_max )
+	{
+		min_x = MIN( min_x, *changed_min - 1 );
+		max_x = MAX( max_x, *changed_max + 1 );
+	}
+	min_x = MAX( min_x, 0 );
+	max_x = MIN( max_x, width - 1 );
 
-		if( energy_area.exit == true )
+	if( y == 0 )
+	{
+		for( int x = min_x; x <= max_x; x++ )
 		{
-			//thread is exiting
-			break;
+			Row[x] = (*(energy_area->Edge))(x,0) + (*(energy_area->D_Weights))(x,0);
 		}
+	}
+	else
+	{
+		int * Prev = &(*(energy_area->Energy_Map))(0,y-1);
 
-		if( Path == NULL )
+		Energy_Row( energy_area, y, MAX( min_x, 1 ), MIN( max_x, width - 2 ), Prev, Row );
+		if( min_x == 0 )
 		{
-			min_x = energy_area.top_x;
-			max_x = energy_area.bot_x;
+			Row[0] = Energy_Boundry( energy_area, 0, y, Prev );
 		}
-		else
+		if( max_x == width - 1 )
 		{
-			min_x = MAX( Path[0]-3, energy_area.top_x );
-			max_x = MIN( Path[0]+2, energy_area.bot_x );	
+			Row[width-1] = Energy_Boundry( energy_area, width - 1, y, Prev );
 		}
+	}
 
-		//lock our mutexes
-		for( int i = 0; i < mutex_height; i++ )
+	//keep what actually changed
+	int new_min = width, new_max = -1;
+	for( int x = min_x; x <= max_x; x++ )
+	{
+		if( Row[x] != Cur[x] )
 		{
-			pthread_mutex_lock( &(energy_area.Mine)[i] );
+			Cur[x] = Row[x];
+			new_min = MIN( new_min, x );
+			new_max = x;
 		}
+	}
+	*changed_min = new_min;
+	*changed_max = new_max;
+}
+
+//=========================================================================================================//
+//Updates the energy map after Path was removed or added, instead of recalculating all of it.
+//Each row is recalculated around where the path went through it (the edges, weights, and costs there have changed),
+//and wherever the row above actually changed value. Once the new values match the old ones, the changes stop spreading
+//down the map, so this ends up with the same map as a full recalculation.
+//This is done by the calling thread, since the changed area is usually much too small to be worth splitting up.
+void Energy_Update( Thread_Params * energy_area, int * Path )
+{
+	int width = (*(energy_area->Edge)).Width();
+	int * Row = new int[width]; //the row of freshly calculated energy
+	int changed_min = 0, changed_max = -1; //the part of the row above that changed, empty to start with
 
-		//signal we are done
-		sem_post( &(energy_sem[2]) );
+	for( int y = 0; y < (*(energy_area->Edge)).Height(); y++ )
+	{
+		Energy_Update_Row( energy_area, Path, y, width, Row, &changed_min, &changed_max );
+	}
 
-		//wait until we are good to go
-		sem_wait( &(energy_sem[3]) );
+	delete[] Row;
+} //end Energy_Update()
 
-		//set the first row with the correct energy
-		for( int x = min_x; x <= max_x; x++ )
+//=========================================================================================================//
+//Calculates the whole energy map in one go, for when there are no threads to split it between.
+//This is the same as what Energy_Left() and Energy_Right() do together, without any of the locking.
+void Energy_Whole( CAIR_Context * context, Thread_Params * energy_area )
+{
+	int width = (*(energy_area->Edge)).Width();
+	int map_height = (*(energy_area->Energy_Map)).Height();
+
+	int * Cur = &(*(energy_area->Energy_Map))(0,0);
+	for( int x = 0; x < width; x++ )
+	{
+		Cur[x] = (*(energy_area->Edge))(x,0) + (*(energy_area->D_Weights))(x,0);
+	}
+
+	for( int y = 1; (y < (*(energy_area->Edge)).Height()) && (Cancelled( context ) == false); y++ )
+	{
+		int * Prev = Cur;
+		Cur = &(*(energy_area->Energy_Map))(0,y % map_height);
+
+		Cur[0] = Energy_Boundry( energy_area, 0, y, Prev );
+		Energy_Row( energy_area, y, 1, width - 2, Prev, Cur );
+		if( width > 1 )
 		{
-			(*(energy_area.Energy_Map))(x,0) = (*(energy_area.Edge))(x,0) + (*(energy_area.D_Weights))(x,0);
+			Cur[width-1] = Energy_Boundry( energy_area, width - 1, y, Prev );
 		}
+	}
+} //end Energy_Whole()
 
-		//now signal that one is done
-		pthread_mutex_unlock( &(energy_area.Mine)[0] );
+//=========================================================================================================//
+//Calculates the energy map from Edge, adding in Weights where needed. The Path is the one last removed or added, and is used
+//to only update the parts of the Map that have changed (see Energy_Update()). A Path of NULL will cause the Map to be fully recalculated.
+//Forward energy needs the cost planes of Edge in Costs. Dir gets the direction each pixel came from, and must be the size of Edge.
+//When fully recalculating, Map can be only ROLLING_ROWS high, with row y kept in row y % ROLLING_ROWS.
+void Energy_Map( CAIR_Context * context, CML_int * Edge, CML_int * Weights, CML_int * Map, CML_dir * Dir, CAIR_energy ener, Cost_Planes * Costs, int * Path )
+{
+	//set the paramaters
+	//left side
+	context->thread_info[0].Edge = Edge;
+	context->thread_info[0].D_Weights = Weights;
+	context->thread_info[0].Energy_Map = Map;
+	context->thread_info[0].Dir = Dir;
+	context->thread_info[0].top_x = 0;
+	context->thread_info[0].bot_x = (*Edge).Width() / 2;
+	context->thread_info[0].ener = ener;
+	context->thread_info[0].Costs = Costs;
+	context->thread_info[0].Mine = context->Left_Mutexes;
+	context->thread_info[0].Not_Mine = context->Right_Mutexes;
+
+	if( Path != NULL )
+	{
+		Energy_Update( &(context->thread_info[0]), Path );
+		return;
+	}
 
-		for( int y = 1; y < (*(energy_area.Edge)).Height(); y++ )
-		{
-			min_x = MAX( min_x-1, energy_area.top_x );
-			max_x = MIN( max_x+1, energy_area.bot_x );
+	//without our pool there's no telling if the left and right would run side by side
+	if( context->pooled == false )
+	{
+		context->thread_info[0].bot_x = (*Edge).Width() - 1;
+		Energy_Whole( context, &(context->thread_info[0]) );
+		return;
+	}
 
-			for( int x = min_x ; x <= max_x; x++ ) //+1 because we handle that seperately
-			{
-				if( x == energy_area.bot_x )
-				{
-					//being the edge value, forward energy would have no benefit here, and hence is not checked
-					energy = MIN( (*(energy_area.Energy_Map))(energy_area.bot_x,y-1), (*(energy_area.Energy_Map))(energy_area.bot_x-1,y-1) )
-							  + (*(energy_area.Edge))(energy_area.bot_x,y) + (*(energy_area.D_Weights))(energy_area.bot_x,y);
+	//the right side
+	context->thread_info[1] = context->thread_info[0];
+	context->thread_info[1].top_x = context->thread_info[0].bot_x + 1;
+	context->thread_info[1].bot_x = (*Edge).Width() - 1;
+	context->thread_info[0].Mine = context->Right_Mutexes;
+	context->thread_info[0].Not_Mine = context->Left_Mutexes;
 
-				}
-				else
-				{	    
-					if(x == energy_area.top_x )//get access to the bad pixel (the one not maintained by us)
-					{
-						pthread_mutex_lock( &(energy_area.Not_Mine)[y-1] );
-						pthread_mutex_unlock( &(energy_area.Not_Mine)[y-1] );
-					}
+	//startup the left and the right
+	Start_Tasks( context, Energy_Task, 2 );
 
-					if( energy_area.ener == BACKWARD )
-					{
-						//grab the minimum of straight up, up left, or up right
-						energy = min_of_three( (*(energy_area.Energy_Map))(x-1,y-1),
-											   (*(energy_area.Energy_Map))(x,y-1),
-											   (*(energy_area.Energy_Map))(x+1,y-1) )
-								 + (*(energy_area.Edge))(x,y) + (*(energy_area.D_Weights))(x,y);
-					}
-					else
-					{
-						energy = min_of_three( (*(energy_area.Energy_Map))(x-1,y-1) + Forward_CostL(energy_area.Edge,x,y),
-											   (*(energy_area.Energy_Map))(x,y-1) + Forward_CostU(energy_area.Edge,x,y),
-											   (*(energy_area.Energy_Map))(x+1,y-1) + Forward_CostR(energy_area.Edge,x,y) )
-								 + (*(energy_area.D_Weights))(x,y);
-					}
-				}
+	//wait for them to lock
+	Spin_Wait( context, &(context->energy_sem[0]) );
+	Spin_Wait( context, &(context->energy_sem[0]) );
 
-				//now we have the energy
-				if( (*(energy_area.Energy_Map))(x,y) == energy && Path != NULL )
-				{
-					if( x == min_x && Path[y] > x+3 ) min_x++;
-					if( x == max_x && Path[y] < x-2 ) max_x--;
-				}
-				else
-				{//set the energy of the pixel
-					 (*(energy_area.Energy_Map))(x,y) = energy;
-				}
-			} 
-			pthread_mutex_unlock( &(energy_area.Mine)[y] );// could be put in the loop for faster a releasing of the mutex, but to be VERY carefull (use a boolean on the previous lock) 
-		}
+	//fire them up
+	sem_post( &(context->energy_sem[1]) );
+	sem_post( &(context->energy_sem[1]) );
 
-		//signal we're done
-		sem_post( &(energy_sem[4]) );
-	} //end while(true)
+	//now wait on them
+	Finish_Tasks( context );
 
-	return NULL;
-} //end Energy_Right()
+} //end Energy_Map()
 
 //=========================================================================================================//
-//Calculates the energy map from Edge, adding in Weights where needed. The Path is used to determine how much of the
-//given Map is to remain unchanged. A Path of NULL will cause the Map to be fully recalculated.
-void Energy_Map( CML_int * Edge, CML_int * Weights, CML_int * Map, CAIR_energy ener, int * Path )
+//Finds the least energy Path from an energy map that is already done, and returns the total energy of that path.
+int Least_Path( CML_int * Energy, CML_dir * Dir, int * Path )
 {
-	//set the paramaters
-	//left side
-	thread_info[0].Edge = Edge;
-	thread_info[0].D_Weights = Weights;
-	thread_info[0].Energy_Map = Map;
-	thread_info[0].Path = Path;
-	thread_info[0].top_x = 0;
-	thread_info[0].bot_x = (*Edge).Width() / 2;
-	thread_info[0].ener = ener;
-	thread_info[0].Mine = Left_Mutexes;
-	thread_info[0].Not_Mine = Right_Mutexes;
-
-	//the right side
-	thread_info[1] = thread_info[0];
-	thread_info[1].top_x = thread_info[0].bot_x + 1;
-	thread_info[1].bot_x = (*Edge).Width() - 1;
-	thread_info[0].Mine = Right_Mutexes;
-	thread_info[0].Not_Mine = Left_Mutexes;
-
-	//startup the left
-	sem_post( &(energy_sem[0]) );
-
-	//wait for it to lock
-	sem_wait( &(energy_sem[2]) );
-
-	//startup the right
-	sem_post( &(energy_sem[1]) );
-
-	//wait for it to lock
-	sem_wait( &(energy_sem[2]) );
-
-	//fire them up
-	sem_post( &(energy_sem[3]) );
-	sem_post( &(energy_sem[3]) );
-
-	//now wait on them
-	sem_wait( &(energy_sem[4]) );
-	sem_wait( &(energy_sem[4]) );
+	//find minimum path start
+	int * Bottom = &(*Energy)( 0, ((*Dir).Height() - 1) % (*Energy).Height() );
+	int min_x = 0;
+	for( int x = 0; x < (*Energy).Width(); x++ )
+	{
+		if( Bottom[x] < Bottom[min_x] )
+		{
+			min_x = x;
+		}
+	}
 
-} //end Energy_Map()
+	//walk the path back up from the directions
+	Generate_Path( Dir, min_x, Path );
+	return Bottom[min_x];
+}
 
 //=========================================================================================================//
 //Energy_Path() generates the least energy Path of the Edge and Weights and returns the total energy of that path.
 //This uses a dynamic programming method to easily calculate the path and energy map (see wikipedia for a good example).
-//Weights should be of the same size as Edge, Path should be of proper length (the height of Edge).
-int Energy_Path( CML_int * Edge, CML_int * Weights, CML_int * Energy, int * Path, CAIR_energy ener, bool first_time )
+//Weights and Dir should be of the same size as Edge, Path should be of proper length (the height of Edge).
+//Energy can be only ROLLING_ROWS high when first_time is always true, since nothing is kept for the next path.
+int Energy_Path( CAIR_Context * context, CML_int * Edge, CML_int * Weights, CML_int * Energy, CML_dir * Dir, int * Path, CAIR_energy ener, Cost_Planes * Costs, bool first_time )
 {
 	(*Energy).Resize_Width( (*Edge).Width() );
+	(*Dir).Resize_Width( (*Edge).Width() );
 
 	//calculate the energy map
 	if( first_time == true )
 	{
-		Energy_Map( Edge, Weights, Energy, ener, NULL );
+		Energy_Map( context, Edge, Weights, Energy, Dir, ener, Costs, NULL );
 	}
 	else
 	{
-		Energy_Map( Edge, Weights, Energy, ener, Path );
+		Energy_Map( context, Edge, Weights, Energy, Dir, ener, Costs, Path );
 	}
 
-	//find minimum path start
-	int min_x = 0;
-	for( int x = 0; x < (*Energy).Width(); x++ )
+	//a cancelled map could lead anywhere, so just hand back a safe path and let the caller notice the cancel
+	if( Cancelled( context ) == true )
 	{
-		if( (*Energy)(x, (*Energy).Height() - 1 ) < (*Energy)(min_x, (*Energy).Height() - 1 ) )
+		for( int y = 0; y < (*Edge).Height(); y++ )
 		{
-			min_x = x;
+			Path[y] = 0;
 		}
+		return 0;
 	}
 
-	//generate the path back from the energy map
-	Generate_Path( Energy, min_x, Path );
-	return (*Energy)( min_x, (*Energy).Height() - 1 );
+	return Least_Path( Energy, Dir, Path );
 }
 
 //=========================================================================================================//
@@ -930,198 +1342,316 @@ int Energy_Path( CML_int * Edge, CML_int * Weights, CML_int * Energy, int * Path
 
 //=========================================================================================================//
 //averages two pixels and returns the values
-CML_RGBA Average_Pixels( CML_RGBA Pixel1, CML_RGBA Pixel2 )
+//All four channels are done at once as packed bytes: the shared bits plus half the differing bits, with the low bit of
+//each byte masked off so nothing carries into its neighbor. This rounds down just like ( a + b ) / 2 per channel.
+inline CML_RGBA Average_Pixels( CML_RGBA Pixel1, CML_RGBA Pixel2 )
 {
-	CML_RGBA average;
+	unsigned int a, b;
+	memcpy( &a, &Pixel1, sizeof(CML_RGBA) );
+	memcpy( &b, &Pixel2, sizeof(CML_RGBA) );
 
-	average.alpha = ( Pixel1.alpha + Pixel2.alpha ) / 2;
-	average.blue = ( Pixel1.blue + Pixel2.blue ) / 2;
-	average.green = ( Pixel1.green + Pixel2.green ) / 2;
-	average.red = ( Pixel1.red + Pixel2.red ) / 2;
+	unsigned int packed = ( a & b ) + ( ( ( a ^ b ) & 0xFEFEFEFE ) >> 1 );
 
+	CML_RGBA average;
+	memcpy( &average, &packed, sizeof(CML_RGBA) );
 	return average;
 }
 
 //=========================================================================================================//
-//This works like Remove_Quadrant, stripes across the image.
-void * Add_Quadrant( void * id )
+//Duplicates every pixel in row y that isn't listed in Index, putting the copy to its left like Add_Path() does. The row is
+//enlarged in place from the right, so the image and weights must have the room Reserve()'ed.
+void Insert_Seams_Row( Thread_Params * add_area, int y )
 {
-	int num = (uintptr_t)id;
-	Thread_Params add_area;
-
-	while( true )
+	CML_RGBA * Pixels = &(*(add_area->Source))(0,y);
+	int * Weights = &(*(add_area->D_Weights))(0,y);
+	int * Kept = &(*(add_area->Index))(0,y);
+	int width = (*(add_area->Source)).Width();
+	int kept = (*(add_area->Index)).Width() - 1;
+	int dest = width + (width - (*(add_area->Index)).Width()) - 1;
+
+	for( int x = width - 1; x >= 0; x-- )
 	{
-		sem_wait( &(add_sem[0]) );
+		CML_RGBA pixel = Pixels[x];
+		int weight = Weights[x];
 
-		//get updated_parameters
-		add_area = thread_info[num];
+		Pixels[dest] = pixel;
+		Weights[dest] = weight;
+		dest--;
 
-		if( add_area.exit == true )
+		if( (kept >= 0) && (Kept[kept] == x) )
 		{
-			//thread is exiting
-			break;
+			kept--;
 		}
-
-		//first add the weights with the artificial weights
-		//Adds the two weight matrircies, Weights and the artifical weight, into Sum.
-		//This is so the new-path artificial weight doesn't poullute our input Weight matrix.
-		for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+		else
 		{
-			for( int x = 0; x < (*(add_area.D_Weights)).Width(); x++ )
-			{
-				(*(add_area.Sum_Weight))(x,y) = (*(add_area.Add_Weight))(x,y) + (*(add_area.D_Weights))(x,y);
-			}
+			//one of the paths, so add the new pixel
+			int left = MAX( x - 1, 0 );
+			Pixels[dest] = Average_Pixels( pixel, Pixels[left] );
+			Weights[dest] = ( weight + Weights[left] ) / 2;
+			dest--;
 		}
+	}
+}
 
-		//signal that part is done
-		sem_post( &(add_sem[3]) );
+//=========================================================================================================//
+//All of the paths going in at once, for one strip (see Insert_Seams()).
+void Insert_Seams_Task( CAIR_Context * context, int num )
+{
+	Thread_Params add_area = context->thread_info[num];
 
-		//wait to begin the next part
-		sem_wait( &(add_sem[1]) );
+	for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+	{
+		Insert_Seams_Row( &add_area, y );
+	}
+}
 
-		//get updated_parameters
-		add_area = thread_info[num];
+//=========================================================================================================//
+//The first time around, before there's a path (see Start_Weight_Add()).
+void Weight_Sum_Task( CAIR_Context * context, int num )
+{
+	Thread_Params add_area = context->thread_info[num];
 
-		for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+	//Adds the two weight matrircies, Weights and the artifical weight, into Sum.
+	//This is so the new-path artificial weight doesn't poullute our input Weight matrix.
+	for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+	{
+		for( int x = 0; x < (*(add_area.D_Weights)).Width(); x++ )
 		{
-			int add = (add_area.Path)[y];
+			(*(add_area.Sum_Weight))(x,y) = (*(add_area.Add_Weight))(x,y) + (*(add_area.D_Weights))(x,y);
+		}
+	}
+}
 
-			//shift over everyone to the right
-			(*(add_area.Source)).Shift_Row( add, y, 1 );
-			(*(add_area.Add_Weight)).Shift_Row( add, y, 1 );
-			(*(add_area.D_Weights)).Shift_Row( add, y, 1 );
-			(*(add_area.Gray)).Shift_Row( add, y, 1 );
-			(*(add_area.Energy_Map)).Shift_Row( add, y, 1 );
-			
-			//go back and set the added pixel
-			(*(add_area.Source))(add,y) = Average_Pixels( (*(add_area.Source))(add,y), (*(add_area.Source)).Get(add-1,y));
-			(*(add_area.D_Weights))(add,y) = ( (*(add_area.D_Weights))(add,y) + (*(add_area.D_Weights)).Get(add-1,y) ) / 2;
-			(*(add_area.Gray))(add,y) = Grayscale_Pixel( &(*(add_area.Source))(add,y) );
+//=========================================================================================================//
+//This works like Remove_Task, stripes across the image.
+//The path goes into all the image layers first. The edges wait until every strip is done with that, since they need
+//the grayscale rows of the strips above and below.
+void Add_Task( CAIR_Context * context, int num )
+{
+	Thread_Params add_area = context->thread_info[num];
 
-			(*(add_area.Add_Weight))(add,y) = add_area.add_weight; //the new path
-			if( add < (*(add_area.Add_Weight)).Width() )
-			{
-				(*(add_area.Add_Weight))(add+1,y) += add_area.add_weight; //the previous least-energy path
-			}
+	for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+	{
+		int add = (add_area.Path)[y];
+
+		//shift over everyone to the right
+		(*(add_area.Source)).Shift_Row( add, y, 1 );
+		(*(add_area.Add_Weight)).Shift_Row( add, y, 1 );
+		(*(add_area.D_Weights)).Shift_Row( add, y, 1 );
+		(*(add_area.Sum_Weight)).Shift_Row( add, y, 1 );
+		(*(add_area.Gray)).Shift_Row( add, y, 1 );
+		(*(add_area.Energy_Map)).Shift_Row( add, y, 1 );
+		(*(add_area.Dir)).Shift_Row( add, y, 1 );
+		
+		//go back and set the added pixel
+		(*(add_area.Source))(add,y) = Average_Pixels( (*(add_area.Source))(add,y), (*(add_area.Source)).Get(add-1,y));
+		(*(add_area.D_Weights))(add,y) = ( (*(add_area.D_Weights))(add,y) + (*(add_area.D_Weights)).Get(add-1,y) ) / 2;
+		(*(add_area.Gray))(add,y) = Grayscale_Pixel( &(*(add_area.Source))(add,y) );
+
+		(*(add_area.Add_Weight))(add,y) = add_area.add_weight; //the new path
+		(*(add_area.Sum_Weight))(add,y) = add_area.add_weight + (*(add_area.D_Weights))(add,y);
+		if( add < (*(add_area.Add_Weight)).Width() )
+		{
+			(*(add_area.Add_Weight))(add+1,y) += add_area.add_weight; //the previous least-energy path
+			(*(add_area.Sum_Weight))(add+1,y) = (*(add_area.Add_Weight))(add+1,y) + (*(add_area.D_Weights))(add+1,y);
 		}
+	}
+}
 
-		//signal that part is done
-		sem_post( &(add_sem[3]) );
-
-		//wait to begin the edges
-		sem_wait( &(add_sem[2]) );
+//=========================================================================================================//
+//Fixes the edges around the added path, for one strip (see Add_Task()).
+void Add_Edge_Task( CAIR_Context * context, int num )
+{
+	Thread_Params add_area = context->thread_info[num];
 
-		//get updated_parameters
-		add_area = thread_info[num];
+	for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+	{
+		int add = (add_area.Path)[y];
+		edge_safe safety = UNSAFE;
+		if( (y <= 3) || (y >= (*(add_area.Edge)).Height() - 4) || (add <= 3) || (add >= (*(add_area.Edge)).Width() - 4) )
+		{
+			safety = SAFE;
+		}
 
-		for( int y = add_area.top_y; y < add_area.bot_y; y++ )
+		(*(add_area.Edge)).Shift_Row( add, y, 1 );
+		if( add_area.Costs != NULL )
 		{
-			int add = (add_area.Path)[y];
-			edge_safe safety = UNSAFE;
-			if( (y <= 3) || (y >= (*(add_area.Edge)).Height() - 4) || (add <= 3) || (add >= (*(add_area.Edge)).Width() - 4) )
-			{
-				safety = SAFE;
-			}
+			(*(add_area.Costs)).Left.Shift_Row( add, y, 1 );
+			(*(add_area.Costs)).Up.Shift_Row( add, y, 1 );
+			(*(add_area.Costs)).Right.Shift_Row( add, y, 1 );
+		}
 
-			(*(add_area.Edge)).Shift_Row( add, y, 1 );
+		//these checks assume a convolution kernel no larger than 3x3
+		if( (add - 1) >= 0 )
+		{
+			(*(add_area.Edge))(add-1,y) = Convolve_Pixel( add_area.Gray, add-1, y, safety, add_area.conv );
 
-			//these checks assume a convolution kernel no larger than 3x3
-			if( (add - 1) >= 0 )
+			if( (add - 2) >= 0 )
 			{
-				(*(add_area.Edge))(add-1,y) = Convolve_Pixel( add_area.Gray, add-1, y, safety, add_area.conv );
+				(*(add_area.Edge))(add-2,y) = Convolve_Pixel( add_area.Gray, add-2, y, safety, add_area.conv );
 
-				if( (add - 2) >= 0 )
+				if( (add - 3) >= 0 )
 				{
-					(*(add_area.Edge))(add-2,y) = Convolve_Pixel( add_area.Gray, add-2, y, safety, add_area.conv );
-
-					if( (add - 3) >= 0 )
-					{
-						(*(add_area.Edge))(add-3,y) = Convolve_Pixel( add_area.Gray, add-3, y, safety, add_area.conv );
-					}
+					(*(add_area.Edge))(add-3,y) = Convolve_Pixel( add_area.Gray, add-3, y, safety, add_area.conv );
 				}
 			}
+		}
 
-			//no checks on these since they will always be there
-			(*(add_area.Edge))(add,y) = Convolve_Pixel( add_area.Gray, add, y, safety, add_area.conv );
-			(*(add_area.Edge))(add+1,y) = Convolve_Pixel( add_area.Gray, add+1, y, safety, add_area.conv );
+		//no checks on these since they will always be there
+		(*(add_area.Edge))(add,y) = Convolve_Pixel( add_area.Gray, add, y, safety, add_area.conv );
+		(*(add_area.Edge))(add+1,y) = Convolve_Pixel( add_area.Gray, add+1, y, safety, add_area.conv );
 
-			if( (add + 2) < (*(add_area.Edge)).Width() )
-			{
-				(*(add_area.Edge))(add+2,y) = Convolve_Pixel( add_area.Gray, add+2, y, safety, add_area.conv );
+		if( (add + 2) < (*(add_area.Edge)).Width() )
+		{
+			(*(add_area.Edge))(add+2,y) = Convolve_Pixel( add_area.Gray, add+2, y, safety, add_area.conv );
 
-				if( (add + 3) < (*(add_area.Edge)).Width() )
-				{
-					(*(add_area.Edge))(add+3,y) = Convolve_Pixel( add_area.Gray, add+3, y, safety, add_area.conv );
-				}
+			if( (add + 3) < (*(add_area.Edge)).Width() )
+			{
+				(*(add_area.Edge))(add+3,y) = Convolve_Pixel( add_area.Gray, add+3, y, safety, add_area.conv );
 			}
-		} //end edge loop
-
-		//signal the add thread is done
-		sem_post( &(add_sem[3]) );
+		}
 
-	} //end while(true)
-	return NULL;
+		//the costs need the edge row above, so the top of our strip is left for Add_Path()
+		if( (add_area.Costs != NULL) && (y > add_area.top_y) )
+		{
+			Repair_Costs( add_area.Edge, add_area.Costs, add_area.Path, y, (*(add_area.Edge)).Width() );
+		}
+	} //end edge loop
 }
 
 //=========================================================================================================//
 //Adds Path into Source, storing the result in Dest.
-//AWeights is used to store the enlarging artifical weights.
-void Add_Path( CML_color * Source, int * Path, CML_int * Weights, CML_int * Edge, CML_gray * Grayscale, CML_int * AWeights, CML_int * Energy, int add_weight, CAIR_convolution conv )
+//AWeights is used to store the enlarging artifical weights, and SumWeights is kept as Weights + AWeights (see Start_Weight_Add()).
+//Costs are the forward energy cost planes, or NULL.
+void Add_Path( CAIR_Context * context, CML_color * Source, int * Path, CML_int * Weights, CML_int * Edge, CML_gray * Grayscale, CML_int * AWeights, CML_int * SumWeights, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, int add_weight, CAIR_convolution conv )
 {
 	(*Source).Resize_Width( (*Source).Width() + 1 );
 	(*AWeights).Resize_Width( (*Source).Width() );
+	(*SumWeights).Resize_Width( (*Source).Width() );
 	(*Weights).Resize_Width( (*Source).Width() );
 	(*Edge).Resize_Width( (*Source).Width() );
 	(*Grayscale).Resize_Width( (*Source).Width() );
 	(*Energy).Resize_Width( (*Source).Width() );
+	(*Dir).Resize_Width( (*Source).Width() );
+	if( Costs != NULL )
+	{
+		(*Costs).Left.Resize_Width( (*Source).Width() );
+		(*Costs).Up.Resize_Width( (*Source).Width() );
+		(*Costs).Right.Resize_Width( (*Source).Width() );
+	}
 
-	int thread_height = (*Source).Height() / num_threads;
+	int thread_height = (*Source).Height() / context->num_strips;
 
 	//setup parameters
-	for( int i = 0; i < num_threads; i++ )
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		thread_info[i].Source = Source;
-		thread_info[i].Path = Path;
-		thread_info[i].D_Weights = Weights;
-		thread_info[i].Add_Weight = AWeights;
-		thread_info[i].Edge = Edge;
-		thread_info[i].conv = conv;
-		thread_info[i].Gray = Grayscale;
-		thread_info[i].Energy_Map = Energy;
-		thread_info[i].add_weight = add_weight;
-		thread_info[i].top_y = i * thread_height;
-		thread_info[i].bot_y = thread_info[i].top_y + thread_height;
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].Path = Path;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].Add_Weight = AWeights;
+		context->thread_info[i].Sum_Weight = SumWeights;
+		context->thread_info[i].Edge = Edge;
+		context->thread_info[i].conv = conv;
+		context->thread_info[i].Gray = Grayscale;
+		context->thread_info[i].Energy_Map = Energy;
+		context->thread_info[i].Dir = Dir;
+		context->thread_info[i].Costs = Costs;
+		context->thread_info[i].add_weight = add_weight;
+		context->thread_info[i].Index = NULL;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
 
-	//have the last thread pick up the slack
-	thread_info[num_threads-1].bot_y = (*Source).Height();
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = (*Source).Height();
+
+	Run_Tasks( context, Add_Task, context->num_strips );
 
-	//startup the threads
-	for( int i = 0; i < num_threads; i++ )
+	//We have to wait until the grayscale image is correctly shifted to avoid bad things from happening when we edge detect.
+	//We may try to get a value on the bounderies of the strips before the row is shifted.
+	Run_Tasks( context, Add_Edge_Task, context->num_strips );
+
+	if( Costs != NULL )
 	{
-		sem_post( &(add_sem[1]) );
+		//all of the edges are fixed, so we can do the cost rows on the strip boundries
+		for( int i = 0; i < context->num_strips; i++ )
+		{
+			if( (context->thread_info[i].top_y > 0) && (context->thread_info[i].top_y < context->thread_info[i].bot_y) )
+			{
+				Repair_Costs( Edge, Costs, Path, context->thread_info[i].top_y, (*Edge).Width() );
+			}
+		}
 	}
 
-	//now wait for them to come back to us
-	for( int i = 0; i < num_threads; i++ )
+} //end Add_Path()
+
+//=========================================================================================================//
+//Moves the rows of the strip over to the worker running it (see Place_Rows()).
+void Place_Task( CAIR_Context * context, int num )
+{
+	Thread_Params place_area = context->thread_info[num];
+
+	for( int y = place_area.top_y; y < place_area.bot_y; y++ )
 	{
-		sem_wait( &(add_sem[3]) );
+		(*(place_area.Source)).Move_Row( y );
+		(*(place_area.D_Weights)).Move_Row( y );
+		(*(place_area.Gray)).Move_Row( y );
+		(*(place_area.Edge)).Move_Row( y );
+		(*(place_area.Energy_Map)).Move_Row( y );
+		(*(place_area.Dir)).Move_Row( y );
+		if( place_area.Add_Weight != NULL )
+		{
+			(*(place_area.Add_Weight)).Move_Row( y );
+			(*(place_area.Sum_Weight)).Move_Row( y );
+		}
+		if( place_area.Costs != NULL )
+		{
+			(*(place_area.Costs)).Left.Move_Row( y );
+			(*(place_area.Costs)).Up.Move_Row( y );
+			(*(place_area.Costs)).Right.Move_Row( y );
+		}
+		if( place_area.Index != NULL )
+		{
+			(*(place_area.Index)).Move_Row( y );
+		}
 	}
+}
 
-	//We have to wait until the grayscale image is correctly shifted to avoid bad things from happening when we edge detect.
-	//We may try to get a value on the bounderies of the threads before the row is shifted.
-	for( int i = 0; i < num_threads; i++ )
+//=========================================================================================================//
+//With pinned workers (see CAIR_Affinity()), has each worker move the rows of its own strips into memory it allocates, so they end up
+//on its NUMA node. The strips are split the same way every stage splits them, so each worker then finds its rows close by.
+//Add_Weight, Sum_Weight, Costs, and Index can be NULL. Does nothing without pinned workers.
+void Place_Rows( CAIR_Context * context, CML_color * Source, CML_int * Weights, CML_int * Add_Weight, CML_int * Sum_Weight, CML_gray * Grayscale, CML_int * Edge, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, CML_int * Index )
+{
+	if( (context->pooled == false) || (context->pool_pinned == false) )
 	{
-		sem_post( &(add_sem[2]) );
+		return;
 	}
 
-	//now wait on them again
-	for( int i = 0; i < num_threads; i++ )
+	int thread_height = (*Source).Height() / context->num_strips;
+
+	//setup parameters
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		sem_wait( &(add_sem[3]) );
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].Add_Weight = Add_Weight;
+		context->thread_info[i].Sum_Weight = Sum_Weight;
+		context->thread_info[i].Gray = Grayscale;
+		context->thread_info[i].Edge = Edge;
+		context->thread_info[i].Energy_Map = Energy;
+		context->thread_info[i].Dir = Dir;
+		context->thread_info[i].Costs = Costs;
+		context->thread_info[i].Index = Index;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
 
-} //end Add_Path()
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = (*Source).Height();
+
+	Run_Tasks( context, Place_Task, context->num_strips );
+}
 
 //=========================================================================================================//
 //Performs non-destructive Reserving for weights.
@@ -1157,31 +1687,24 @@ void Copy_Reserved( CML_color * Source, CML_color * Dest )
 }
 
 //=========================================================================================================//
-//start the add threads to add the user-given weights with the artifical path weights to a sum matrix
-void Start_Weight_Add( CML_int * Weights, CML_int * art_weights, CML_int * sum_weights )
+//start the add tasks to add the user-given weights with the artifical path weights to a sum matrix
+//This is only needed once, since Add_Path() keeps the sum up to date from there.
+void Start_Weight_Add( CAIR_Context * context, CML_int * Weights, CML_int * art_weights, CML_int * sum_weights )
 {
 	//setup the thread info for the sum-weights part
-	int thread_height = (*Weights).Height() / num_threads;
-	for( int i = 0; i < num_threads; i++ )
+	int thread_height = (*Weights).Height() / context->num_strips;
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		thread_info[i].Sum_Weight = sum_weights;
-		thread_info[i].Add_Weight = art_weights;
-		thread_info[i].D_Weights = Weights;
-		thread_info[i].top_y = i * thread_height;
-		thread_info[i].bot_y = thread_info[i].top_y + thread_height;
+		context->thread_info[i].Sum_Weight = sum_weights;
+		context->thread_info[i].Add_Weight = art_weights;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
-	thread_info[num_threads-1].bot_y = (*Weights).Height();
+	context->thread_info[context->num_strips-1].bot_y = (*Weights).Height();
 
-	//fire up the threads to do the artifical weight sum
-	for( int j = 0; j < num_threads; j++ )
-	{
-		sem_post( &(add_sem[0]) );
-	}
-	//wait on them
-	for( int j = 0; j < num_threads; j++ )
-	{
-		sem_wait( &(add_sem[3]) );
-	}
+	//fire up the tasks to do the artifical weight sum
+	Run_Tasks( context, Weight_Sum_Task, context->num_strips );
 }
 
 //=========================================================================================================//
@@ -1194,10 +1717,22 @@ void Start_Weight_Add( CML_int * Weights, CML_int * art_weights, CML_int * sum_w
 //a very large add_weight will cause the algorithm to work more like a linear algorithm, evenly distributing new paths.
 //Having a very small weight will cause stretching. I provide this as a paramater mainly because I don't know if someone
 //will see a need for it, so I might of well leave it in.
-bool CAIR_Add( CML_color * Source, CML_int * Weights, int goal_x, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done )
+bool CAIR_Add( CAIR_Context * context, CML_color * Source, CML_int * Weights, int goal_x, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done )
 {
+	//paths can't be removed below 3 pixels wide, and are recorded and played back one at a time
+	if( (context->add_mode == SEAM_ORDER) && ((*Source).Width() >= 6) && (context->record == NULL) && (context->replay == NULL) )
+	{
+		return CAIR_Add_Seams( context, Source, Weights, goal_x, conv, ener, Dest, CAIR_callback, total_seams, seams_done );
+	}
+
+	//the copies and transposes before us can take a while on a huge image
+	if( Cancelled( context ) == true )
+	{
+		return false;
+	}
+
 	//adjust energy thread mutexes
-	Resize_Threads( (*Source).Height() );
+	Resize_Threads( context, (*Source).Height() );
 
 	CML_gray Grayscale( (*Source).Width(), (*Source).Height() );
 
@@ -1206,6 +1741,9 @@ bool CAIR_Add( CML_color * Source, CML_int * Weights, int goal_x, int add_weight
 	CML_int sum_weight( (*Source).Width(), (*Source).Height() ); //the sum of Weights and the artifical weight
 	CML_int Edge( (*Source).Width(), (*Source).Height() );
 	CML_int Energy( (*Source).Width(), (*Source).Height() );
+	CML_dir Dir( (*Source).Width(), (*Source).Height() );
+	Cost_Planes Cost_Map;
+	Cost_Planes * Costs = Setup_Costs( &Cost_Map, ener, (*Source).Width(), (*Source).Height() );
 	int * Min_Path = new int[(*Source).Height()];
 
 	//increase thier reserved size as we enlarge. non-destructive resizes would be too slow
@@ -1214,41 +1752,79 @@ bool CAIR_Add( CML_color * Source, CML_int * Weights, int goal_x, int add_weight
 	Grayscale.Reserve( goal_x, (*Source).Height() );
 	Edge.Reserve( goal_x, (*Source).Height() );
 	Energy.Reserve( goal_x, (*Source).Height() );
+	Dir.Reserve( goal_x, (*Source).Height() );
 	Reserve_Weights( Weights, goal_x );
 	art_weight.Reserve( goal_x, (*Source).Height() );
 	sum_weight.Reserve( goal_x, (*Source).Height() );
+	if( Costs != NULL )
+	{
+		(*Costs).Left.Reserve( goal_x, (*Source).Height() );
+		(*Costs).Up.Reserve( goal_x, (*Source).Height() );
+		(*Costs).Right.Reserve( goal_x, (*Source).Height() );
+	}
 
 	//clear the new weight
 	art_weight.Fill( 0 );
 
+	Place_Rows( context, Dest, Weights, &art_weight, &sum_weight, &Grayscale, &Edge, &Energy, &Dir, Costs, NULL );
+
 	//have to do this first to get it started
 	Copy_Reserved( Source, Dest );
-	Grayscale_Image( Source, &Grayscale );
-	Edge_Detect( &Grayscale, &Edge, conv );
+	Grayscale_Image( context, Source, &Grayscale );
+	Edge_Detect( context, &Grayscale, &Edge, conv, Costs );
+	Start_Weight_Add( context, Weights, &art_weight, &sum_weight );
+
+	int * Coarse_Min = NULL; //the path from CAIR_Replay()'s list
+	int band_paths = 0; //and how many have been added in its band
+	if( context->replay != NULL )
+	{
+		Coarse_Min = new int[(*Source).Height()];
+	}
 
 	for( int i = 0; i < adds; i++ )
 	{
 		//If you're going to maintain some sort of progress counter/bar, here's where you would do it!
-		if( (CAIR_callback != NULL) && (CAIR_callback( (float)(i+seams_done)/total_seams ) == false) )
+		if( (Cancelled( context ) == true) || ((CAIR_callback != NULL) && (CAIR_callback( (float)(i+seams_done)/total_seams ) == false)) )
 		{
 			delete[] Min_Path;
+			delete[] Coarse_Min;
 			return false;
 		}
 
-		Start_Weight_Add( Weights, &art_weight, &sum_weight );
-		if( i == 0 )
+		if( context->replay != NULL )
+		{
+			//each path in the list is added scale_x times, in a band that grows as they go in
+			if( band_paths == 0 )
+			{
+				Next_Seam( context->replay, Coarse_Min );
+			}
+			Refine_Path( &Edge, &sum_weight, &Energy, &Dir, Costs, ener, Coarse_Min, context->replay->scale_x, context->replay->scale_y, context->replay->width, context->replay->height, -band_paths, Min_Path );
+			band_paths++;
+			if( band_paths == context->replay->scale_x )
+			{
+				context->replay->width++;
+				band_paths = 0;
+			}
+		}
+		else if( i == 0 )
 		{
-			Energy_Path( &Edge, &sum_weight, &Energy, Min_Path, ener, true );
+			Energy_Path( context, &Edge, &sum_weight, &Energy, &Dir, Min_Path, ener, Costs, true );
 		}
 		else
 		{
-			Energy_Path( &Edge, &sum_weight, &Energy, Min_Path, ener, false );
+			Energy_Path( context, &Edge, &sum_weight, &Energy, &Dir, Min_Path, ener, Costs, false );
 		}
-		Add_Path( Dest, Min_Path, Weights, &Edge, &Grayscale, &art_weight, &Energy, add_weight, conv );
+
+		if( context->record != NULL )
+		{
+			Record_Path( context->record, Min_Path, (*Dest).Height(), 1 );
+		}
+		Add_Path( context, Dest, Min_Path, Weights, &Edge, &Grayscale, &art_weight, &sum_weight, &Energy, &Dir, Costs, add_weight, conv );
 
 	}
 
 	delete[] Min_Path;
+	delete[] Coarse_Min;
 	return true;
 } //end CAIR_Add()
 
@@ -1257,902 +1833,4173 @@ bool CAIR_Add( CML_color * Source, CML_int * Weights, int goal_x, int add_weight
 //=========================================================================================================//
 
 //=========================================================================================================//
-//more multi-threaded goodness
-//the areas are not quadrants, rather, more like strips, but I keep the name convention
-void * Remove_Quadrant( void * id )
+//Removes all of the batch paths from row y of the image and weights, blending them back in like a single path.
+//The paths in the row must be in order from left to right.
+void Remove_Batch_Row( Thread_Params * remove_area, int y )
 {
-	int num = (uintptr_t)id;
-	Thread_Params remove_area;
+	int * Row_Path = &(remove_area->Path)[y * remove_area->batch_size];
+	CML_RGBA * Pixels = &(*(remove_area->Source))(0,y);
+	int * Weights = &(*(remove_area->D_Weights))(0,y);
+	int width = (*(remove_area->Source)).Width();
 
-	while( true )
+	//average the removed pixels back in
+	for( int i = 0; i < remove_area->batch_size; i++ )
 	{
-		sem_wait( &(remove_sem[0]) );
+		int remove = Row_Path[i];
 
-		//get updated parameters
-		remove_area = thread_info[num];
-
-		if( remove_area.exit == true )
-		{
-			//thread is exiting
-			break;
-		}
-
-		//remove
-		for( int y = remove_area.top_y; y < remove_area.bot_y; y++ )
+		if( Weights[remove] >= 0 ) //otherwise area marked for removal, don't blend
 		{
-			//reduce each row by one, the removed pixel
-			int remove = (remove_area.Path)[y];
-
-			//now, bounds check the assignments
 			if( (remove - 1) > 0 )
 			{
-				if( (*(remove_area.D_Weights))(remove,y) >= 0 ) //otherwise area marked for removal, don't blend
-				{
-					//average removed pixel back in
-					(*(remove_area.Source))(remove-1,y) = Average_Pixels( (*(remove_area.Source))(remove,y), (*(remove_area.Source)).Get(remove-1,y) );
-				}
-				(*(remove_area.Gray))(remove-1,y) = Grayscale_Pixel( &(*(remove_area.Source))(remove-1,y) );
+				Pixels[remove-1] = Average_Pixels( Pixels[remove], Pixels[remove-1] );
 			}
-
-			if( (remove + 1) < (*(remove_area.Source)).Width() )
+			if( (remove + 1) < width )
 			{
-				if( (*(remove_area.D_Weights))(remove,y) >= 0 ) //otherwise area marked for removal, don't blend
-				{
-					//average removed pixel back in
-					(*(remove_area.Source))(remove+1,y) = Average_Pixels( (*(remove_area.Source))(remove,y), (*(remove_area.Source)).Get(remove+1,y) );
-				}
-				(*(remove_area.Gray))(remove+1,y) = Grayscale_Pixel( &(*(remove_area.Source))(remove+1,y) );
+				Pixels[remove+1] = Average_Pixels( Pixels[remove], Pixels[remove+1] );
 			}
+		}
+	}
+
+	//now close up the gaps, moving each stretch between the paths over all at once
+	int dest = Row_Path[0];
+	for( int i = 0; i < remove_area->batch_size; i++ )
+	{
+		int next = ( i + 1 < remove_area->batch_size ) ? Row_Path[i+1] : width;
+		int count = next - Row_Path[i] - 1;
+
+		memmove( &(Pixels[dest]), &(Pixels[Row_Path[i]+1]), count * sizeof(CML_RGBA) );
+		memmove( &(Weights[dest]), &(Weights[Row_Path[i]+1]), count * sizeof(int) );
+		if( remove_area->Index != NULL )
+		{
+			int * Index = &(*(remove_area->Index))(0,y);
+			memmove( &(Index[dest]), &(Index[Row_Path[i]+1]), count * sizeof(int) );
+		}
+		dest += count;
+	}
+}
+
+//=========================================================================================================//
+//Takes the path out of row y of the image, weights, grayscale, index, energy, and directions, blending it back into the image.
+//The grayscale has already been sized down for the edges (see Remove_Path()), so everything is worked on as raw rows.
+inline void Remove_Row( Thread_Params * remove_area, int y )
+{
+	//reduce each row by one, the removed pixel
+	int remove = (remove_area->Path)[y];
+	int width = (*(remove_area->Source)).Width();
+	CML_RGBA * Pixels = &(*(remove_area->Source))(0,y);
+	CML_byte * Gray = &(*(remove_area->Gray))(0,y);
+	int * Weights = &(*(remove_area->D_Weights))(0,y);
+	bool blend = Weights[remove] >= 0; //otherwise area marked for removal, don't blend
+
+	//now, bounds check the assignments
+	if( (remove - 1) > 0 )
+	{
+		if( blend )
+		{
+			//average removed pixel back in
+			Pixels[remove-1] = Average_Pixels( Pixels[remove], Pixels[remove-1] );
+		}
+		Gray[remove-1] = Grayscale_Pixel( &Pixels[remove-1] );
+	}
 
-			//shift everyone over
-			(*(remove_area.Source)).Shift_Row( remove + 1, y, -1 );
-			(*(remove_area.Gray)).Shift_Row( remove + 1, y, -1 );
-			(*(remove_area.D_Weights)).Shift_Row( remove + 1, y, -1 );
-			(*(remove_area.Energy_Map)).Shift_Row( remove + 1, y, -1 );//to be recalculated ...
+	if( (remove + 1) < width )
+	{
+		if( blend )
+		{
+			//average removed pixel back in
+			Pixels[remove+1] = Average_Pixels( Pixels[remove], Pixels[remove+1] );
 		}
+		Gray[remove+1] = Grayscale_Pixel( &Pixels[remove+1] );
+	}
+
+	//shift everyone over, all the layers in the same pass
+	if( remove_area->Energy_Map != NULL )
+	{
+		int * Energy = &(*(remove_area->Energy_Map))(0,y); //to be recalculated ...
+		signed char * Dir = &(*(remove_area->Dir))(0,y);
 
-		//signal that part is done
-		sem_post( &(remove_sem[2]) );
+		for( int x = remove; x < width - 1; x++ )
+		{
+			Pixels[x] = Pixels[x+1];
+			Gray[x] = Gray[x+1];
+			Weights[x] = Weights[x+1];
+			Energy[x] = Energy[x+1];
+			Dir[x] = Dir[x+1];
+		}
+	}
+	else
+	{
+		for( int x = remove; x < width - 1; x++ )
+		{
+			Pixels[x] = Pixels[x+1];
+			Gray[x] = Gray[x+1];
+			Weights[x] = Weights[x+1];
+		}
+	}
+	if( remove_area->Index != NULL )
+	{
+		int * Index = &(*(remove_area->Index))(0,y);
+		memmove( &(Index[remove]), &(Index[remove+1]), (width - 1 - remove) * sizeof(int) );
+	}
+}
 
-		//wait to begin edge removal
-		sem_wait( &(remove_sem[1]) );
+//=========================================================================================================//
+//Corrects the edge values of row y that have changed around the removed path, and shifts the edges and costs over.
+//The grayscale rows y-1 through y+1 must already be removed.
+inline void Remove_Edge_Row( Thread_Params * remove_area, int y )
+{
+	int remove = (remove_area->Path)[y];
+	int width = (*(remove_area->Gray)).Width(); //the new width
+	edge_safe safety = UNSAFE;
+	if( (y <= 3) || (y >= (*(remove_area->Edge)).Height() - 4) || (remove <= 3) || (remove >= (*(remove_area->Edge)).Width() - 4) )
+	{
+		safety = SAFE;
+	}
 
-		//get updated parameters
-		remove_area = thread_info[num];
+	//these checks assume a convolution kernel no larger than 3x3
+	//check we don't blow past the left of the map
+	if( (remove - 3) >= 0 )
+	{
+		(*(remove_area->Edge))(remove-3,y) = Convolve_Pixel( remove_area->Gray, remove-3, y, safety, remove_area->conv );
 
-		//correct the edge values that have changed around the removed path
-		for( int y = remove_area.top_y; y < remove_area.bot_y; y++ )
+		if( (remove - 2) >= 0 )
 		{
-			int remove = (remove_area.Path)[y];
-			edge_safe safety = UNSAFE;
-			if( (y <= 3) || (y >= (*(remove_area.Edge)).Height() - 4) || (remove <= 3) || (remove >= (*(remove_area.Edge)).Width() - 4) )
+			(*(remove_area->Edge))(remove-2,y) = Convolve_Pixel( remove_area->Gray, remove-2, y, safety, remove_area->conv );
+
+			if( (remove - 1) >= 0 )
 			{
-				safety = SAFE;
+				(*(remove_area->Edge))(remove-1,y) = Convolve_Pixel( remove_area->Gray, remove-1, y, safety, remove_area->conv );
 			}
+		}
+	}
+	
+	//check we don't blow past the right of the map
+	if( (remove + 1) < width )
+	{
+		(*(remove_area->Edge))(remove+1,y) = Convolve_Pixel( remove_area->Gray, remove, y, safety, remove_area->conv );
+
+		if( (remove + 2) < width )
+		{
+			(*(remove_area->Edge))(remove+2,y) = Convolve_Pixel( remove_area->Gray, remove+1, y, safety, remove_area->conv );
 
-			//these checks assume a convolution kernel no larger than 3x3
-			//check we don't blow past the left of the map
-			if( (remove - 3) >= 0 )
+			if( (remove + 3) < width )
 			{
-				(*(remove_area.Edge))(remove-3,y) = Convolve_Pixel( remove_area.Gray, remove-3, y, safety, remove_area.conv );
+				(*(remove_area->Edge))(remove+3,y) = Convolve_Pixel( remove_area->Gray, remove+2, y, safety, remove_area->conv );
+			}
+		}
+	}
 
-				if( (remove - 2) >= 0 )
-				{
-					(*(remove_area.Edge))(remove-2,y) = Convolve_Pixel( remove_area.Gray, remove-2, y, safety, remove_area.conv );
+	//now we can safely shift
+	(*(remove_area->Edge)).Shift_Row( remove + 1, y, -1 );
+	if( remove_area->Costs != NULL )
+	{
+		(*(remove_area->Costs)).Left.Shift_Row( remove + 1, y, -1 );
+		(*(remove_area->Costs)).Up.Shift_Row( remove + 1, y, -1 );
+		(*(remove_area->Costs)).Right.Shift_Row( remove + 1, y, -1 );
+	}
+}
 
-					if( (remove - 1) >= 0 )
-					{
-						(*(remove_area.Edge))(remove-1,y) = Convolve_Pixel( remove_area.Gray, remove-1, y, safety, remove_area.conv );
-					}
-				}
-			}
-			
-			//check we don't blow past the right of the map
-			if( (remove + 1) < (*(remove_area.Source)).Width() )
-			{
-				(*(remove_area.Edge))(remove+1,y) = Convolve_Pixel( remove_area.Gray, remove, y, safety, remove_area.conv );
+//=========================================================================================================//
+//more multi-threaded goodness
+//Each strip is one task, done in one sweep: a row is removed, then the edges are fixed a row behind it (they need the row below),
+//and the costs a row behind that (they need the edges above). The first and last rows of the strip need the strips next
+//to it, so they are left for Remove_Path().
+void Remove_Task( CAIR_Context * context, int num )
+{
+	Thread_Params remove_area = context->thread_info[num];
 
-				if( (remove + 2) < (*(remove_area.Source)).Width() )
-				{
-					(*(remove_area.Edge))(remove+2,y) = Convolve_Pixel( remove_area.Gray, remove+1, y, safety, remove_area.conv );
+	for( int y = remove_area.top_y; (y < remove_area.bot_y) && (Cancelled( context ) == false); y++ )
+	{
+		Remove_Row( &remove_area, y );
 
-					if( (remove + 3) < (*(remove_area.Source)).Width() )
-					{
-						(*(remove_area.Edge))(remove+3,y) = Convolve_Pixel( remove_area.Gray, remove+2, y, safety, remove_area.conv );
-					}
-				}
-			}
+		if( (y - 1) > remove_area.top_y )
+		{
+			Remove_Edge_Row( &remove_area, y - 1 );
 
-			//now we can safely shift
-			(*(remove_area.Edge)).Shift_Row( remove + 1, y, -1 );
+			if( (remove_area.Costs != NULL) && ((y - 2) > remove_area.top_y) )
+			{
+				Repair_Costs( remove_area.Edge, remove_area.Costs, remove_area.Path, y - 1, (*(remove_area.Gray)).Width() );
+			}
 		}
+	}
 
-		//signal we're now done
-		sem_post( &(remove_sem[2]) );
-	} //end while( true )
+	//signal we're now done
+	if( context->pooled == true )
+	{
+		sem_post( &(context->remove_done[num]) );
+	}
+} //end Remove_Task()
 
-	return NULL;
-} //end Remove_Quadrant()
+//=========================================================================================================//
+//A batch only takes the one pass, since everything else is recalculated afterwards (see Remove_Batch()).
+void Remove_Batch_Task( CAIR_Context * context, int num )
+{
+	Thread_Params remove_area = context->thread_info[num];
+
+	for( int y = remove_area.top_y; (y < remove_area.bot_y) && (Cancelled( context ) == false); y++ )
+	{
+		Remove_Batch_Row( &remove_area, y );
+	}
+}
 
 //=========================================================================================================//
 //Removes the requested path from the Edge, Weights, and the image itself.
-//Edge and the image have the path blended back into the them.
+//Edge and the image have the path blended back into the them. The forward energy cost planes, if any, are repaired as well.
+//If Energy and Dir aren't NULL they are updated for the path (see Energy_Update()), and Least_Path() can be used right away.
+//Otherwise they are left to be fully recalculated.
+//Index, if not NULL, has the path removed too, so it keeps track of where the remaining pixels came from.
+//This all happens in one sweep down the image. The tasks do their strips, and we finish the rows between the strips
+//and update the energy right behind them, as each strip is done.
 //Weights and Edge better match the dimentions of Source! Path needs to be the same length as the height of the image!
-void Remove_Path( CML_color * Source, int * Path, CML_int * Weights, CML_int * Edge, CML_gray * Grayscale, CML_int * Energy, CAIR_convolution conv )
+void Remove_Path( CAIR_Context * context, CML_color * Source, int * Path, CML_int * Weights, CML_int * Edge, CML_gray * Grayscale, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, CML_int * Index, CAIR_convolution conv )
 {
-	int thread_height = (*Source).Height() / num_threads;
+	int height = (*Source).Height();
+	int width = (*Source).Width() - 1; //what we'll be when we're done
+	int thread_height = height / context->num_strips;
+
+	//the edges are fixed as we go, so the grayscale has to be the right size from the start
+	(*Grayscale).Resize_Width( width );
 
 	//setup parameters
-	for( int i = 0; i < num_threads; i++ )
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		thread_info[i].Source = Source;
-		thread_info[i].Path = Path;
-		thread_info[i].D_Weights = Weights;
-		thread_info[i].Edge = Edge;
-		thread_info[i].conv = conv;
-		thread_info[i].Gray = Grayscale;
-		thread_info[i].Energy_Map = Energy;
-		thread_info[i].top_y = i * thread_height;
-		thread_info[i].bot_y = thread_info[i].top_y + thread_height;
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].Path = Path;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].Edge = Edge;
+		context->thread_info[i].conv = conv;
+		context->thread_info[i].ener = ( Costs == NULL ) ? BACKWARD : FORWARD;
+		context->thread_info[i].Gray = Grayscale;
+		context->thread_info[i].Energy_Map = Energy;
+		context->thread_info[i].Dir = Dir;
+		context->thread_info[i].Costs = Costs;
+		context->thread_info[i].batch_size = 1;
+		context->thread_info[i].Index = Index;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
 
-	//have the last thread pick up the slack
-	thread_info[num_threads-1].bot_y = (*Source).Height();
-
-	//start the four threads
-	for( int i = 0; i < num_threads; i++ )
-	{
-		sem_post( &(remove_sem[0]) );
-	}
-	//now wait on them
-	for( int i = 0; i < num_threads; i++ )
-	{
-		sem_wait( &(remove_sem[2]) );
-	}
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = height;
 
-	//now we can safely resize everyone down
-	(*Source).Resize_Width( (*Source).Width() - 1 );
-	(*Weights).Resize_Width( (*Source).Width() );
-	(*Grayscale).Resize_Width( (*Source).Width() );
-	//Energy_Path() will resize Energy
+	//start the tasks
+	Start_Tasks( context, Remove_Task, context->num_strips );
 
-	//now get the threads to handle the edge
-	//we must wait for the grayscale to be complete before we can recalculate changed edge values
-	for( int i = 0; i < num_threads; i++ )
+	//with the last column gone there's no energy left to update
+	int * Row = NULL; //for the energy update
+	int changed_min = 0, changed_max = -1;
+	bool update = (Energy != NULL) && (width > 0);
+	if( update == true )
 	{
-		sem_post( &(remove_sem[1]) );
+		Row = new int[width];
 	}
 
-	//now wait on them, ... again
-	for( int i = 0; i < num_threads; i++ )
+	//follow the strips down the image
+	int y = 0;
+	int strip = 0;
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		sem_wait( &(remove_sem[2]) );
-	}
+		if( context->pooled == true )
+		{
+			Spin_Wait( context, &(context->remove_done[i]) );
+		}
 
-	(*Edge).Resize_Width( (*Source).Width() );
-} //end Remove_Path()
+		//the last row of this strip still needs the next one
+		int ready = ( i == context->num_strips - 1 ) ? height : context->thread_info[i].bot_y - 1;
 
-//=========================================================================================================//
-//Removes all requested vertical paths form the image.
-bool CAIR_Remove( CML_color * Source, CML_int * Weights, int goal_x, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done )
-{
-	//readjust energy thread mutexes
-	Resize_Threads( (*Source).Height() );
+		for( ; y < ready; y++ )
+		{
+			while( y >= context->thread_info[strip].bot_y )
+			{
+				strip++;
+			}
+			int top_y = context->thread_info[strip].top_y;
+			int bot_y = context->thread_info[strip].bot_y;
 
-	CML_gray Grayscale( (*Source).Width(), (*Source).Height() );
+			//whatever the task couldn't do
+			if( (y == top_y) || (y == bot_y - 1) )
+			{
+				Remove_Edge_Row( &(context->thread_info[strip]), y );
+			}
+			if( (Costs != NULL) && (y > 0) && ((y <= top_y + 1) || (y == bot_y - 1)) )
+			{
+				Repair_Costs( Edge, Costs, Path, y, width );
+			}
 
-	int removes = (*Source).Width() - goal_x;
-	CML_int Edge( (*Source).Width(), (*Source).Height() );
-	CML_int Energy( (*Source).Width(), (*Source).Height() );
-	int * Min_Path = new int[(*Source).Height()];
+			if( update == true )
+			{
+				Energy_Update_Row( &(context->thread_info[strip]), Path, y, width, Row, &changed_min, &changed_max );
+			}
+		}
+	}
 
-	//setup the images
-	(*Dest) = (*Source);
-	Grayscale_Image( Source, &Grayscale );
-	Edge_Detect( &Grayscale, &Edge, conv );
+	delete[] Row;
+	Finish_Tasks( context );
 
-	for( int i = 0; i < removes; i++ )
+	//now we can safely resize everyone down
+	(*Source).Resize_Width( width );
+	(*Weights).Resize_Width( width );
+	(*Edge).Resize_Width( width );
+	if( Index != NULL )
 	{
-		//If you're going to maintain some sort of progress counter/bar, here's where you would do it!
-		if( (CAIR_callback != NULL) && (CAIR_callback( (float)(i+seams_done)/total_seams ) == false) )
-		{
-			delete[] Min_Path;
-			return false;
-		}
-
-		if( i == 0 )
-		{
-			Energy_Path( &Edge, Weights, &Energy, Min_Path, ener, true );
-		}
-		else
-		{
-			Energy_Path( &Edge, Weights, &Energy, Min_Path, ener, false );
-		}
-		Remove_Path( Dest, Min_Path, Weights, &Edge, &Grayscale, &Energy, conv );
+		(*Index).Resize_Width( width );
 	}
-
-	delete[] Min_Path;
-	return true;
-} //end CAIR_Remove()
+	if( Energy != NULL )
+	{
+		(*Energy).Resize_Width( width );
+		(*Dir).Resize_Width( width );
+	}
+	if( Costs != NULL )
+	{
+		(*Costs).Left.Resize_Width( width );
+		(*Costs).Up.Resize_Width( width );
+		(*Costs).Right.Resize_Width( width );
+	}
+} //end Remove_Path()
 
 //=========================================================================================================//
-//Startup all threads, create all needed semaphores.
-//NOTE: This does NOT create the mutexes for the energy threads! Use Resize_Threads() after this, to do that.
-void Startup_Threads()
+//Sorts the bottom row starting points of the batch paths by their energy, least first.
+struct Energy_Less
 {
-	//create semaphores
-	sem_init( &(remove_sem[0]), 0, 0 ); //start
-	sem_init( &(remove_sem[1]), 0, 0 ); //edge_start
-	sem_init( &(remove_sem[2]), 0, 0 ); //finish
-	sem_init( &(add_sem[0]), 0, 0 ); //add_start
-	sem_init( &(add_sem[1]), 0, 0 ); //start
-	sem_init( &(add_sem[2]), 0, 0 ); //edge_start
-	sem_init( &(add_sem[3]), 0, 0 ); //finish
-	sem_init( &(edge_sem[0]), 0, 0 ); //start
-	sem_init( &(edge_sem[1]), 0, 0 ); //finish
-	sem_init( &(gray_sem[0]), 0, 0 ); //start
-	sem_init( &(gray_sem[1]), 0, 0 ); //finish
-	sem_init( &(energy_sem[0]), 0, 0 ); //start_left
-	sem_init( &(energy_sem[1]), 0, 0 ); //start_right
-	sem_init( &(energy_sem[2]), 0, 0 ); //locks_done
-	sem_init( &(energy_sem[3]), 0, 0 ); //good_to_go
-	sem_init( &(energy_sem[4]), 0, 0 ); //finish
+	int * Bottom;
 
-	//create the thread handles
-	remove_threads = new pthread_t[num_threads];
-	edge_threads   = new pthread_t[num_threads];
-	gray_threads   = new pthread_t[num_threads];
-	add_threads    = new pthread_t[num_threads];
-
-	thread_info = new Thread_Params[num_threads];
+	bool operator()( int a, int b ) const
+	{
+		return ( Bottom[a] < Bottom[b] ) || ( (Bottom[a] == Bottom[b]) && (a < b) );
+	}
+};
 
-	//startup the threads
-	for( int i = 0; i < num_threads; i++ )
+//=========================================================================================================//
+//Follows the directions back up from the bottom pixel start, staying between the Left and Right paths (NULL for the image edges).
+//When a direction would run into one of them, the least energy pixel above that is still allowed is taken instead.
+//Returns false if the path gets boxed in.
+bool Trace_Between( CML_int * Energy, CML_dir * Dir, int start, int * Left, int * Right, int * Path )
+{
+	int x = start;
+	for( int y = (*Dir).Height() - 1; y >= 0; y-- )
 	{
-		thread_info[i].exit = false;
+		int low = ( Left == NULL ) ? -1 : Left[y];
+		int high = ( Right == NULL ) ? (*Dir).Width() : Right[y];
 
-		pthread_create( &(remove_threads[i]), NULL, Remove_Quadrant, (void *)i );
-		pthread_create( &(edge_threads[i]), NULL, Edge_Quadrant, (void *)i );
-		pthread_create( &(gray_threads[i]), NULL, Gray_Quadrant, (void *)i );
-		pthread_create( &(add_threads[i]), NULL, Add_Quadrant, (void *)i );
-	}
+		if( y < (*Dir).Height() - 1 )
+		{
+			int from = x;
+			x += (*Dir)(from,y+1);
+
+			if( (x <= low) || (x >= high) )
+			{
+				//reroute to the best of what's left
+				x = -1;
+				for( int i = MAX( from - 1, low + 1 ); i <= MIN( from + 1, high - 1 ); i++ )
+				{
+					if( (x == -1) || ((*Energy)(i,y) < (*Energy)(x,y)) )
+					{
+						x = i;
+					}
+				}
+			}
+		}
 
-	//startup energy
-	pthread_create( &(energy_threads[0]), NULL, Energy_Left, (void *)0 );
-	pthread_create( &(energy_threads[1]), NULL, Energy_Right, (void *)1 );
+		if( (x <= low) || (x >= high) )
+		{
+			return false;
+		}
+		Path[y] = x;
+	}
+	return true;
 }
 
 //=========================================================================================================//
-//Creates or resizes the arrays of mutexes for the two energy threads, depending on the height of the image.
-void Resize_Threads( int height )
+//Finds up to count paths from one energy map that don't cross or touch each other. They start from the separate low points
+//(local minima) of the bottom row, least energy first, and are kept in order by where they sit. Any path that costs more
+//than batch_quality percent over the best one is passed up. The first path is always the same one Generate_Path() would give.
+//Batch gets the paths row by row, from left to right within each row. Returns the number of paths found.
+int Batch_Paths( CAIR_Context * context, CML_int * Energy, CML_dir * Dir, int * Batch, int count )
 {
-	if( Left_Mutexes != NULL )
+	int width = (*Energy).Width();
+	int height = (*Energy).Height();
+	int * Bottom = &(*Energy)(0,height-1);
+
+	//gather the low points, taking only the left end of any flat spots (like Generate_Path() would)
+	int * Starts = new int[width];
+	int start_count = 0;
+	for( int x = 0; x < width; x++ )
 	{
-		//clear out and delete the left
-		for( int i = 0; i < mutex_height; i++ )
+		if( ((x == 0) || (Bottom[x] < Bottom[x-1])) && ((x == width - 1) || (Bottom[x] <= Bottom[x+1])) )
 		{
-			pthread_mutex_destroy( &(Left_Mutexes[i]) );
+			Starts[start_count] = x;
+			start_count++;
 		}
-
-		delete[] Left_Mutexes;
 	}
-	if( Right_Mutexes != NULL )
+	Energy_Less less;
+	less.Bottom = Bottom;
+	sort( Starts, Starts + start_count, less );
+
+	int * Paths = new int[count * height]; //each path found, one after the other
+	int * Order = new int[count]; //the paths from left to right
+	int found = 0;
+	double limit = Bottom[Starts[0]] + (fabs( (double)Bottom[Starts[0]] ) * context->batch_quality) / 100;
+
+	for( int s = 0; (s < start_count) && (found < count); s++ )
 	{
-		//clear out and delete the right
-		for( int i = 0; i < mutex_height; i++ )
+		int start = Starts[s];
+		if( Bottom[start] > limit )
 		{
-			pthread_mutex_destroy( &(Right_Mutexes[i]) );
+			break; //they're sorted, so everyone else is over too
 		}
 
-		delete[] Right_Mutexes;
-	}
+		//find the neighbors that this path has to stay between
+		int place = 0;
+		while( (place < found) && (Paths[Order[place] * height + height - 1] < start) )
+		{
+			place++;
+		}
+		int * Left = ( place > 0 ) ? &(Paths[Order[place-1] * height]) : NULL;
+		int * Right = ( place < found ) ? &(Paths[Order[place] * height]) : NULL;
 
-	//creat the new objects
-	if( height > 0 )
-	{
-		Left_Mutexes = new pthread_mutex_t[height];
-		Right_Mutexes = new pthread_mutex_t[height];
-	}
-	else
-	{
-		Left_Mutexes = NULL;
-		Right_Mutexes = NULL;
+		if( Trace_Between( Energy, Dir, start, Left, Right, &(Paths[found * height]) ) == true )
+		{
+			for( int i = found; i > place; i-- )
+			{
+				Order[i] = Order[i-1];
+			}
+			Order[place] = found;
+			found++;
+		}
 	}
 
-	//init the mutexes
-	for( int i = 0; i < height; i++ )
+	for( int y = 0; y < height; y++ )
 	{
-		pthread_mutex_init( &(Left_Mutexes[i]), NULL );
-		pthread_mutex_init( &(Right_Mutexes[i]), NULL );
+		for( int i = 0; i < found; i++ )
+		{
+			Batch[y * found + i] = Paths[Order[i] * height + y];
+		}
 	}
 
-	mutex_height = height;
+	delete[] Starts;
+	delete[] Paths;
+	delete[] Order;
+	return found;
 }
 
 //=========================================================================================================//
-//Stops all threads. Deletes all semaphores and mutexes.
-void Shutdown_Threads()
+//Removes the count paths in Batch (from Batch_Paths()) from Source, Weights, and Index (if not NULL) in one pass.
+//The grayscale, edges, and energy are all out of date afterwards, and need to be recalculated from scratch.
+void Remove_Batch( CAIR_Context * context, CML_color * Source, int * Batch, int count, CML_int * Weights, CML_int * Index )
 {
-	//notify the threads
-	for( int i = 0; i < num_threads; i++ )
-	{
-		thread_info[i].exit = true;
-	}
+	int thread_height = (*Source).Height() / context->num_strips;
 
-	//start them up
-	for( int i = 0; i < num_threads; i++ )
+	//setup parameters
+	for( int i = 0; i < context->num_strips; i++ )
 	{
-		sem_post( &(remove_sem[0]) );
-		sem_post( &(add_sem[0]) );
-		sem_post( &(edge_sem[0]) );
-		sem_post( &(gray_sem[0]) );
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].Path = Batch;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].batch_size = count;
+		context->thread_info[i].Index = Index;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
-	sem_post( &(energy_sem[0]) );
-	sem_post( &(energy_sem[1]) );
 
-	//wait for the joins
-	for( int i = 0; i < num_threads; i++ )
-	{
-		pthread_join( remove_threads[i], NULL );
-		pthread_join( edge_threads[i], NULL );
-		pthread_join( gray_threads[i], NULL );
-		pthread_join( add_threads[i], NULL );
-	}
-	pthread_join( energy_threads[0], NULL );
-	pthread_join( energy_threads[1], NULL );
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = (*Source).Height();
 
-	//remove the thread handles
-	delete[] remove_threads;
-	delete[] edge_threads;
-	delete[] gray_threads;
-	delete[] add_threads;
+	Run_Tasks( context, Remove_Batch_Task, context->num_strips );
 
-	delete[] thread_info;
+	(*Source).Resize_Width( (*Source).Width() - count );
+	(*Weights).Resize_Width( (*Source).Width() );
+	if( Index != NULL )
+	{
+		(*Index).Resize_Width( (*Source).Width() );
+	}
+} //end Remove_Batch()
 
-	//delete the semaphores
-	sem_destroy( &(remove_sem[0]) ); //start
-	sem_destroy( &(remove_sem[1]) ); //edge_start
-	sem_destroy( &(remove_sem[2]) ); //finish
-	sem_destroy( &(add_sem[0]) ); //add_start
-	sem_destroy( &(add_sem[1]) ); //start
-	sem_destroy( &(add_sem[2]) ); //edge_start
-	sem_destroy( &(add_sem[3]) ); //finish
-	sem_destroy( &(edge_sem[0]) ); //start
-	sem_destroy( &(edge_sem[1]) ); //finish
-	sem_destroy( &(gray_sem[0]) ); //start
-	sem_destroy( &(gray_sem[1]) ); //finish
-	sem_destroy( &(energy_sem[0]) ); //start_left
-	sem_destroy( &(energy_sem[1]) ); //start_right
-	sem_destroy( &(energy_sem[2]) ); //locks_done
-	sem_destroy( &(energy_sem[3]) ); //good_to_go
-	sem_destroy( &(energy_sem[4]) ); //finish
+//=========================================================================================================//
+//Returns the sum of the edges and weights in block X, Y of the coarse map. The last block of each row and column also takes
+//the leftover pixels, so the coarse map covers the whole image.
+int Coarse_Block( CML_int * Edge, CML_int * Weights, int scale, int X, int Y, int coarse_width, int coarse_height )
+{
+	int right = ( X == coarse_width - 1 ) ? (*Edge).Width() : (X + 1) * scale;
+	int bottom = ( Y == coarse_height - 1 ) ? (*Edge).Height() : (Y + 1) * scale;
 
-	//let the mutexes begone!
-	Resize_Threads( 0 );
+	int block = 0;
+	for( int y = Y * scale; y < bottom; y++ )
+	{
+		int * Edge_Row = &(*Edge)(0,y);
+		int * Weight_Row = &(*Weights)(0,y);
+		for( int x = X * scale; x < right; x++ )
+		{
+			block += Edge_Row[x] + Weight_Row[x];
+		}
+	}
+	return block;
 }
 
 //=========================================================================================================//
-//Set the number of threads that CAIR should use. Minimum of 2 required.
-//WARNING: Never call this function while CAIR() is processing an image, otherwise bad things will happen!
-void CAIR_Threads( int thread_count )
+//Fills the block rows from top_y to bot_y of the coarse map (see Coarse_Block()). The rows of each block are added up first,
+//so both loops run straight along the rows.
+void Coarse_Task( CAIR_Context * context, int num )
 {
-	//minimum of two because I need two thread_info[] structs for the energy threads
-	if( thread_count < 2 )
-	{
-		num_threads = 2;
-	}
-	else
+	Thread_Params coarse_area = context->thread_info[num];
+	int scale = coarse_area.add_weight; //reused for the scale
+	CML_int * Coarse_Edge = coarse_area.Add_Weight;
+	int width = (*(coarse_area.Edge)).Width();
+	int height = (*(coarse_area.Edge)).Height();
+	int coarse_width = (*Coarse_Edge).Width();
+	int coarse_height = (*Coarse_Edge).Height();
+	int * Sum = new int[width];
+
+	for( int Y = coarse_area.top_y; (Y < coarse_area.bot_y) && (Cancelled( context ) == false); Y++ )
 	{
-		num_threads = thread_count;
+		for( int x = 0; x < width; x++ )
+		{
+			Sum[x] = 0;
+		}
+
+		int bottom = ( Y == coarse_height - 1 ) ? height : (Y + 1) * scale;
+		for( int y = Y * scale; y < bottom; y++ )
+		{
+			int * Edge = &(*(coarse_area.Edge))(0,y);
+			int * Weights = &(*(coarse_area.D_Weights))(0,y);
+			for( int x = 0; x < width; x++ )
+			{
+				Sum[x] += Edge[x] + Weights[x];
+			}
+		}
+
+		int * Coarse = &(*Coarse_Edge)(0,Y);
+		for( int X = 0; X < coarse_width; X++ )
+		{
+			int right = ( X == coarse_width - 1 ) ? width : (X + 1) * scale;
+			int block = 0;
+			for( int x = X * scale; x < right; x++ )
+			{
+				block += Sum[x];
+			}
+			Coarse[X] = block;
+		}
 	}
+
+	delete[] Sum;
 }
 
 //=========================================================================================================//
-//==                                          F R O N T E N D                                            ==//
-//=========================================================================================================//
-//The Great CAIR Frontend. This baby will retarget Source using S_Weights into the dimensions supplied by goal_x and goal_y into D_Weights and Dest.
-//Weights allows for an area to be biased for removal/protection. A large positive value will protect a portion of the image,
-//and a large negative value will remove it. Do not exceed the limits of int's, as this will cause an overflow. I would suggest
-//a safe range of -2,000,000 to 2,000,000 (this is a maximum guideline, much smaller weights will work just as well for most images).
-//Weights must be the same size as Source. D_Weights will contain the weights of Dest after the resize. Dest is the output,
-//and as such has no constraints (its contents will be destroyed, just so you know). 
-//To prevent the same path from being chosen during an add, and to prevent merging paths from being chosen during an add, 
-//additional weight is placed to the old least-energy path and the new inserted path. Having  a very large add_weight 
-//will cause the algorithm to work more like a linear algorithm. Having a very small add_weight will cause stretching. 
-//A weight of greater than 25 should prevent stretching, but may not evenly distribute paths through an area. 
-//Note: Weights does affect path adding, so a large negative weight will attract the most paths. Also, if add_weight is too large,
-//it may eventually force new paths into areas marked for protection. I am unsure of an exact ratio on such things at this time.
-//The internal order is this: remove horizontal, remove vertical, add horizontal, add vertical.
-//CAIR can use multiple convolution methods to determine the image energy. 
-//Prewitt and Sobel are close to each other in results and represent the "traditional" edge detection.
-//V_SQUARE and V1 can produce some of the better quality results, but may remove from large objects to do so. Do note that V_SQUARE
-//produces much larger edge values, any may require larger weight values (by about an order of magnitude) for effective operation.
-//Laplacian is a second-derivative operator, and can limit some artifacts while generating others.
-//CAIR now can use the new improved energy algorithm called "forward energy." Removing seams can sometimes add energy back to the image
-//by placing nearby edges directly next to each other. Forward energy can get around this by determining the future cost of a seam.
-//Forward energy removes most serious artifacts from a retarget, but is slightly more costly in terms of performance.
-bool CAIR( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+//Sums the edges and weights into blocks of scale x scale pixels for the coarse map, a strip of block rows for each task,
+//and then calculates its energy. The coarse map is small enough to do its energy on this thread, and always uses backward energy.
+void Coarse_Map( CAIR_Context * context, CML_int * Edge, CML_int * Weights, Coarse_Planes * Coarse, int scale )
 {
-	//if no change, then just copy to the source to the destination
-	if( (goal_x == (*Source).Width()) && (goal_y == (*Source).Height() ) )
+	int coarse_width = (*Edge).Width() / scale;
+	int coarse_height = (*Edge).Height() / scale;
+	(*Coarse).Edge.D_Resize( coarse_width, coarse_height );
+	(*Coarse).Weights.D_Resize( coarse_width, coarse_height );
+	(*Coarse).Weights.Fill( 0 );
+	(*Coarse).Energy.D_Resize( coarse_width, coarse_height );
+	(*Coarse).Dir.D_Resize( coarse_width, coarse_height );
+
+	int strips = MIN( context->num_strips, coarse_height );
+	int thread_height = coarse_height / strips;
+
+	//setup parameters
+	for( int i = 0; i < strips; i++ )
 	{
-		(*Dest) = (*Source);
-		(*D_Weights) = (*S_Weights);
-		return true;
+		context->thread_info[i].Edge = Edge;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].Add_Weight = &((*Coarse).Edge);
+		context->thread_info[i].add_weight = scale;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
 	}
 
-	//calculate the total number of operations needed
-	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
-	int seams_done = 0;
+	//have the last strip pick up the slack
+	context->thread_info[strips-1].bot_y = coarse_height;
 
-	//create threads for the run
-	Startup_Threads();
+	Run_Tasks( context, Coarse_Task, strips );
 
-	CML_color Temp( 1, 1 );
-	Temp = (*Source);
-	(*D_Weights) = (*S_Weights);
+	Thread_Params coarse_area;
+	coarse_area.Edge = &((*Coarse).Edge);
+	coarse_area.D_Weights = &((*Coarse).Weights);
+	coarse_area.Energy_Map = &((*Coarse).Energy);
+	coarse_area.Dir = &((*Coarse).Dir);
+	coarse_area.Costs = NULL;
+	coarse_area.ener = BACKWARD;
+	Energy_Whole( context, &coarse_area );
+}
 
-	if( goal_x < (*Source).Width() )
+//=========================================================================================================//
+//Brings the coarse map up to date after scale paths were removed in the band around Coarse_Path (see Refine_Path()).
+//Every row of a block row lost scale pixels from the same three blocks, so everything right of them moved over by exactly
+//one block, the same as if Coarse_Path was removed from the coarse map. Those are shifted over, and only the blocks that the band
+//covered are summed again, along with the blocks next to it whose edges were redone (up to 3 pixels to either side of a path,
+//see Remove_Edge_Row()). Then the energy is updated around Coarse_Path like any other removed path (see Energy_Update()).
+//This is done by the calling thread, since it's only a few blocks in each block row.
+void Coarse_Update( CML_int * Edge, CML_int * Weights, Coarse_Planes * Coarse, int * Coarse_Path, int scale )
+{
+	int coarse_width = (*Coarse).Edge.Width() - 1; //what we'll be when we're done
+	int coarse_height = (*Coarse).Edge.Height();
+
+	for( int Y = 0; Y < coarse_height; Y++ )
 	{
-		if( CAIR_Remove( Source, D_Weights, goal_x, conv, ener, Dest, CAIR_callback, total_seams, seams_done ) == false )
+		int * Blocks = &(*Coarse).Edge(0,Y);
+		int * Energy = &(*Coarse).Energy(0,Y); //to be recalculated ...
+		signed char * Dir = &(*Coarse).Dir(0,Y);
+		int X = Coarse_Path[Y];
+
+		for( int x = X; x < coarse_width; x++ )
 		{
-			Shutdown_Threads();
-			return false;
+			Blocks[x] = Blocks[x+1];
+			Energy[x] = Energy[x+1];
+			Dir[x] = Dir[x+1];
+		}
+
+		int first = MAX( X * scale - scale - 3, 0 ) / scale;
+		int last = MIN( ((X + 1) * scale + 2) / scale, coarse_width - 1 );
+		for( int x = first; x <= last; x++ )
+		{
+			Blocks[x] = Coarse_Block( Edge, Weights, scale, x, Y, coarse_width, coarse_height );
 		}
-		Temp = (*Dest);
-		seams_done += abs((*Source).Width()-goal_x);
 	}
 
-	if( goal_y < (*Source).Height() )
+	(*Coarse).Edge.Resize_Width( coarse_width );
+	(*Coarse).Weights.Resize_Width( coarse_width );
+	(*Coarse).Energy.Resize_Width( coarse_width );
+	(*Coarse).Dir.Resize_Width( coarse_width );
+
+	Thread_Params coarse_area;
+	coarse_area.Edge = &((*Coarse).Edge);
+	coarse_area.D_Weights = &((*Coarse).Weights);
+	coarse_area.Energy_Map = &((*Coarse).Energy);
+	coarse_area.Dir = &((*Coarse).Dir);
+	coarse_area.Costs = NULL;
+	coarse_area.ener = BACKWARD;
+	Energy_Update( &coarse_area, Coarse_Path );
+}
+
+//=========================================================================================================//
+//Finds the least energy path through just a band of the energy map, the columns from Low[y] to High[y] on each row y. Each band
+//is first trimmed to the columns a path could get to from the one above. The same energy as Energy_Map() is used, with
+//everything outside of the band walled off. Only the band of Energy and Dir is written, and the energy of the path goes in
+//path_energy. Returns false if no path made it through the band: either the band was trimmed away, or the real energies grew
+//past BAND_WALL (large weights can do that) and the least one came through a wall. Path is left unfinished then.
+bool Band_Path( CML_int * Edge, CML_int * Weights, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, CAIR_energy ener, int * Low, int * High, int * Path, int * path_energy )
+{
+	int width = (*Edge).Width();
+	int height = (*Edge).Height();
+
+	Thread_Params band_area;
+	band_area.Edge = Edge;
+	band_area.D_Weights = Weights;
+	band_area.Energy_Map = Energy;
+	band_area.Dir = Dir;
+	band_area.Costs = Costs;
+	band_area.ener = ener;
+
+	int prev_min = 0, prev_max = -1;
+	int band_min = 0, band_max = -1;
+	for( int y = 0; y < height; y++ )
 	{
-		//remove horiztonal paths
-		//works like above, except hand it a rotated image AND weights
-		CML_color TSource( 1, 1 );
-		CML_color TDest( 1, 1 );
-		CML_int TWeights( 1, 1 );
-		TSource.Transpose( &Temp );
-		TWeights.Transpose( D_Weights );
+		if( y > 0 )
+		{
+			Low[y] = MAX( Low[y], prev_min - 1 );
+			High[y] = MIN( High[y], prev_max + 1 );
+			if( Low[y] > High[y] )
+			{
+				return false;
+			}
+		}
+		band_min = Low[y];
+		band_max = High[y];
+		int * Cur = &(*Energy)(0,y);
 
-		if( CAIR_Remove( &TSource, &TWeights, goal_y, conv, ener, &TDest, CAIR_callback, total_seams, seams_done ) == false )
+		if( y == 0 )
 		{
-			Shutdown_Threads();
-			return false;
+			int * Edge_Row = &(*Edge)(0,0);
+			int * Weight_Row = &(*Weights)(0,0);
+			for( int x = band_min; x <= band_max; x++ )
+			{
+				Cur[x] = Edge_Row[x] + Weight_Row[x];
+			}
 		}
-		
-		//store back the transposed info
-		(*Dest).Transpose( &TDest );
-		(*D_Weights).Transpose( &TWeights );
-		Temp = (*Dest);
-		seams_done += abs((*Source).Height()-goal_y);
+		else
+		{
+			//wall off whatever is next to us from the row above that wasn't in its band
+			int * Prev = &(*Energy)(0,y-1);
+			for( int x = MAX( band_min - 1, 0 ); x <= MIN( band_max + 1, width - 1 ); x++ )
+			{
+				if( (x < prev_min) || (x > prev_max) )
+				{
+					Prev[x] = BAND_WALL;
+				}
+			}
+
+			if( band_min == 0 )
+			{
+				Cur[0] = Energy_Boundry( &band_area, 0, y, Prev );
+			}
+			Energy_Row( &band_area, y, MAX( band_min, 1 ), MIN( band_max, width - 2 ), Prev, Cur );
+			if( band_max == width - 1 )
+			{
+				Cur[width-1] = Energy_Boundry( &band_area, width - 1, y, Prev );
+			}
+		}
+		prev_min = band_min;
+		prev_max = band_max;
 	}
 
-	if( goal_x > (*Source).Width() )
+	//find the least of the bottom row, and walk back up (see Generate_Path()), stopping if it leaves the band
+	int * Bottom = &(*Energy)(0,height-1);
+	int min_x = band_min;
+	for( int x = band_min; x <= band_max; x++ )
 	{
-		if( CAIR_Add( &Temp, D_Weights, goal_x, add_weight, conv, ener, Dest, CAIR_callback, total_seams, seams_done ) == false )
+		if( Bottom[x] < Bottom[min_x] )
 		{
-			Shutdown_Threads();
-			return false;
+			min_x = x;
 		}
-		Temp = (*Dest); //incase we resize in the y direction
-		seams_done += abs((*Source).Width()-goal_x);
 	}
-	if( goal_y > (*Source).Height() )
-	{
-		//add horiztonal paths
-		//works like above, except hand it a rotated image
-		CML_color TSource( 1, 1 );
-		CML_color TDest( 1, 1 );
-		CML_int TWeights( 1, 1 );
-		TSource.Transpose( &Temp );
-		TWeights.Transpose( D_Weights );
+	(*path_energy) = Bottom[min_x];
 
-		if( CAIR_Add( &TSource, &TWeights, goal_y, add_weight, conv, ener, &TDest, CAIR_callback, total_seams, seams_done ) == false )
+	int x = min_x;
+	for( int y = height - 1; y > 0; y-- )
+	{
+		Path[y] = x;
+		x += (*Dir)(x,y);
+		if( (x < Low[y-1]) || (x > High[y-1]) )
 		{
-			Shutdown_Threads();
 			return false;
 		}
-		
-		//store back the transposed info
-		(*Dest).Transpose( &TDest );
-		(*D_Weights).Transpose( &TWeights );
-		seams_done += abs((*Source).Height()-goal_y);
 	}
-
-	//shutdown threads, remove semaphores and mutexes
-	Shutdown_Threads();
+	Path[0] = x;
 	return true;
-} //end CAIR()
+}
 
 //=========================================================================================================//
-//==                                                E X T R A S                                          ==//
-//=========================================================================================================//
-//Simple function that generates the grayscale image of Source and places the result in Dest.
-void CAIR_Grayscale( CML_color * Source, CML_color * Dest )
+//Finds the least energy path in just a band of the full energy map around Coarse_Path, from a block to the left of it to a block
+//to the right. The blocks are scale_x pixels wide and scale_y pixels high, with the last ones taking the rest of the image.
+//Removed is how many paths have already come out of this band, which it has shrunk by (negative when paths were added).
+//A path can only move over one pixel a row, but the band moves over scale_x pixels every scale_y rows, so when the blocks are
+//wider than they are high it can leave every path behind. The band is stretched back on those rows to where the paths could get.
+//If still no path makes it through (see Band_Path()), the whole width is searched instead. Returns the energy of the path.
+int Refine_Path( CML_int * Edge, CML_int * Weights, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, CAIR_energy ener, int * Coarse_Path, int scale_x, int scale_y, int coarse_width, int coarse_height, int removed, int * Path )
 {
-	Startup_Threads();
+	int width = (*Edge).Width();
+	int height = (*Edge).Height();
+	int * Low = new int[height];
+	int * High = new int[height];
 
-	CML_gray gray( (*Source).Width(), (*Source).Height() );
-	Grayscale_Image( Source, &gray );
+	int reach_min = 0, reach_max = width - 1; //where a path could have got to on the row above
+	for( int y = 0; y < height; y++ )
+	{
+		int X = Coarse_Path[MIN( y / scale_y, coarse_height - 1 )];
+		Low[y] = MAX( X * scale_x - scale_x, 0 );
+		High[y] = ( X == coarse_width - 1 ) ? width - 1 : MIN( (X + 2) * scale_x - 1 - removed, width - 1 );
 
-	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
+		if( y == 0 )
+		{
+			reach_min = Low[0];
+			reach_max = High[0];
+		}
+		else
+		{
+			Low[y] = MIN( Low[y], reach_max + 1 );
+			High[y] = MAX( High[y], reach_min - 1 );
+			reach_min = MAX( Low[y], reach_min - 1 );
+			reach_max = MIN( High[y], reach_max + 1 );
+		}
+	}
 
-	for( int x = 0; x < (*Source).Width(); x++ )
+	int energy = 0;
+	if( Band_Path( Edge, Weights, Energy, Dir, Costs, ener, Low, High, Path, &energy ) == false )
 	{
-		for( int y = 0; y < (*Source).Height(); y++ )
+		//nothing got through the band, so look everywhere, where there are no walls to come through
+		for( int y = 0; y < height; y++ )
 		{
-			(*Dest)(x,y).red = gray(x,y);
-			(*Dest)(x,y).green = gray(x,y);
-			(*Dest)(x,y).blue = gray(x,y);
-			(*Dest)(x,y).alpha = (*Source)(x,y).alpha;
+			Low[y] = 0;
+			High[y] = width - 1;
 		}
+		Band_Path( Edge, Weights, Energy, Dir, Costs, ener, Low, High, Path, &energy );
 	}
-
-	Shutdown_Threads();
+	delete[] Low;
+	delete[] High;
+	return energy;
 }
 
 //=========================================================================================================//
-//Simple function that generates the edge-detection image of Source and stores it in Dest.
-void CAIR_Edge( CML_color * Source, CAIR_convolution conv, CML_color * Dest )
+//Finds the least energy path within reach of where the last path was, which has already been removed. The columns it took are
+//now the ones just to the right of it, so the band is reach columns to either side of those. The energy of the path goes in
+//path_energy. Returns false if no path got through the band (see Band_Path()), and Path can't be used then.
+bool Local_Path( CML_int * Edge, CML_int * Weights, CML_int * Energy, CML_dir * Dir, Cost_Planes * Costs, CAIR_energy ener, int * Last_Path, int reach, int * Path, int * path_energy )
 {
-	Startup_Threads();
+	int width = (*Edge).Width();
+	int height = (*Edge).Height();
+	int * Low = new int[height];
+	int * High = new int[height];
 
-	CML_gray gray( (*Source).Width(), (*Source).Height() );
-	Grayscale_Image( Source, &gray );
+	for( int y = 0; y < height; y++ )
+	{
+		Low[y] = MAX( Last_Path[y] - reach, 0 );
+		High[y] = MIN( Last_Path[y] + reach - 1, width - 1 );
+	}
 
-	CML_int edge( (*Source).Width(), (*Source).Height() );
-	Edge_Detect( &gray, &edge, conv );
+	bool reached = Band_Path( Edge, Weights, Energy, Dir, Costs, ener, Low, High, Path, path_energy );
+	delete[] Low;
+	delete[] High;
+	return reached;
+}
 
-	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
+//=========================================================================================================//
+//Returns what an average path costs on a fully calculated energy map, the mean of its bottom row. This is in the same units as
+//the path energies (forward costs and weights included), and is about what a path would cost if the energy were spread out evenly.
+//Scaling the image down spreads the loss out like that, so it's where carving stops being worth it.
+long long Average_Path( CML_int * Energy )
+{
+	long long total = 0;
+	int * Bottom = &(*Energy)(0,(*Energy).Height()-1);
+	for( int x = 0; x < (*Energy).Width(); x++ )
+	{
+		total += Bottom[x];
+	}
+	return total / MAX( (*Energy).Width(), 1 );
+}
 
-	for( int x = 0; x < (*Source).Width(); x++ )
+//=========================================================================================================//
+//Checks CAIR_Hybrid()'s budget before a path of the given energy is removed. Once a limit is reached, it stays stopped.
+bool Over_Budget( Carve_Budget * budget, long long energy, long long average )
+{
+	if( (budget->stopped == true) || (budget->seams == 0) ||
+		((budget->timed == true) && (std::chrono::steady_clock::now() >= budget->deadline)) ||
+		((budget->payoff > 0) && (energy * 100 >= average * budget->payoff)) )
 	{
-		for( int y = 0; y < (*Source).Height(); y++ )
-		{
-			int value = edge(x,y);
+		budget->stopped = true;
+	}
+	return budget->stopped;
+}
 
-			if( value > 255 )
-			{
-				value = 255;
-			}
+//=========================================================================================================//
+//Copies Dest and Weights out to every rung of the ladder whose width they have come down to.
+//Returns false if CAIR_rung wants the run to stop.
+bool Take_Rungs( Ladder_Rungs * Rungs, CML_color * Dest, CML_int * Weights )
+{
+	while( (Rungs->next < Rungs->count) && (Rungs->widths[Rungs->order[Rungs->next]] >= (*Dest).Width()) )
+	{
+		int rung = Rungs->order[Rungs->next];
+		(*(Rungs->Dests[rung])) = (*Dest);
+		(*(Rungs->D_Weights[rung])) = (*Weights);
+		Rungs->next++;
 
-			(*Dest)(x,y).red = (CML_byte)value;
-			(*Dest)(x,y).green = (CML_byte)value;
-			(*Dest)(x,y).blue = (CML_byte)value;
-			(*Dest)(x,y).alpha = (*Source)(x,y).alpha;
+		if( (Rungs->CAIR_rung != NULL) && (Rungs->CAIR_rung( rung ) == false) )
+		{
+			return false;
 		}
 	}
-
-	Shutdown_Threads();
+	return true;
 }
 
 //=========================================================================================================//
-//Simple function that generates the vertical energy map of Source placing it into Dest.
-//All values are scaled down to their relative gray value. Weights are assumed all zero.
-void CAIR_V_Energy( CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest )
+//Removes all requested vertical paths form the image.
+//If Index isn't NULL, the paths are removed from it as well (see CAIR_Add_Seams()).
+//If Rungs isn't NULL, the image is copied out at each of its widths on the way down (see CAIR_Ladder()).
+//With CAIR_Pyramid() on, the paths come from a coarse map instead of the full energy map (see Coarse_Update() and Refine_Path()).
+//While CAIR_Replay() is running, the coarse paths come from its list instead.
+//With CAIR_Local() on, each path is first looked for near the last one (see Local_Path()), and the full energy map is only
+//brought back up to date when nothing close enough to the last full map's best is found there.
+//While CAIR_Hybrid() is running, this stops early once its budget runs out (see Over_Budget()), leaving Dest wider than goal_x.
+bool CAIR_Remove( CAIR_Context * context, CML_color * Source, CML_int * Weights, int goal_x, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done, CML_int * Index, Ladder_Rungs * Rungs )
 {
-	Startup_Threads();
-	Resize_Threads( (*Source).Height() );
+	//the copies and transposes before us can take a while on a huge image
+	if( Cancelled( context ) == true )
+	{
+		return false;
+	}
 
-	CML_gray gray( (*Source).Width(), (*Source).Height() );
-	Grayscale_Image( Source, &gray );
+	//readjust energy thread mutexes
+	Resize_Threads( context, (*Source).Height() );
 
-	CML_int edge( (*Source).Width(), (*Source).Height() );
-	Edge_Detect( &gray, &edge, conv );
+	CML_gray Grayscale( (*Source).Width(), (*Source).Height() );
 
-	CML_int energy( edge.Width(), edge.Height() );
-	CML_int weights( edge.Width(), edge.Height() );
-	weights.Fill(0);
+	int removes = (*Source).Width() - goal_x;
+	CML_int Edge( (*Source).Width(), (*Source).Height() );
+	CML_int Energy( (*Source).Width(), (*Source).Height() );
+	CML_dir Dir( (*Source).Width(), (*Source).Height() );
+	Cost_Planes Cost_Map;
+	Cost_Planes * Costs = Setup_Costs( &Cost_Map, ener, (*Source).Width(), (*Source).Height() );
+	int * Min_Path = new int[(*Source).Height()];
+	int * Batch = NULL;
+	if( context->batch_size > 1 )
+	{
+		Batch = new int[(*Source).Height() * context->batch_size];
+	}
 
-	//calculate the energy map
-	Energy_Map( &edge, &weights, &energy, ener, NULL );
+	//the coarse map for the pyramid, if it's on
+	int scale = context->pyramid_scale;
+	Coarse_Planes Coarse;
+	int * Coarse_Min = new int[(*Source).Height()];
+	int band_x = scale, band_y = scale; //the size of the blocks
+	int coarse_width = 0, coarse_height = 0;
+	bool pyramid = false;
+	bool coarse_ready = false;
+	int band_paths = 0; //how many paths have come out of the current coarse path's band
+
+	//the local search, if it's on, with its own energy map so a miss leaves the full one alone
+	int reach = context->local_reach;
+	CML_int Local_Energy( (reach > 0) ? (*Source).Width() : 1, (reach > 0) ? (*Source).Height() : 1 );
+	CML_dir Local_Dir( (reach > 0) ? (*Source).Width() : 1, (reach > 0) ? (*Source).Height() : 1 );
+	int * Last_Path = new int[(*Source).Height()];
+	bool have_last = false; //Last_Path is the path that was just removed
+	long long global_best = 0; //the energy of the last path from the full map
+	bool local = false;
+	long long path_energy = 0;
 
-	int max_energy = 0; //find the maximum energy value
-	for( int x = 0; x < energy.Width(); x++ )
+	//setup the images
+	(*Dest) = (*Source);
+	Place_Rows( context, Dest, Weights, NULL, NULL, &Grayscale, &Edge, &Energy, &Dir, Costs, Index );
+	Grayscale_Image( context, Source, &Grayscale );
+	Edge_Detect( context, &Grayscale, &Edge, conv, Costs );
+
+	//what an average path costs on the first full energy map, for when carving stops paying off
+	long long average = 0;
+	if( (context->budget != NULL) && (context->budget->payoff > 0) )
 	{
-		for( int y = 0; y < energy.Height(); y++ )
-		{
-			if( energy(x,y) > max_energy )
-			{
-				max_energy = energy(x,y);
-			}
-		}
+		Energy_Map( context, &Edge, Weights, &Energy, &Dir, ener, Costs, NULL );
+		average = Average_Path( &Energy );
 	}
-	
-	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
 
-	for( int x = 0; x < energy.Width(); x++ )
+	bool first_time = true;
+	for( int i = 0; i < removes; )
 	{
-		for( int y = 0; y < energy.Height(); y++ )
+		//don't let a batch go past the next rung
+		int left = removes - i;
+		if( Rungs != NULL )
 		{
-			//scale the gray value down so we can get a realtive gray value for the energy level
-			int value = (int)(((double)energy(x,y) / max_energy) * 255);
-			if( value < 0 )
+			if( Take_Rungs( Rungs, Dest, Weights ) == false )
 			{
-				value = 0;
+				delete[] Min_Path;
+				delete[] Batch;
+				delete[] Coarse_Min;
+				delete[] Last_Path;
+				return false;
 			}
+			left = (*Dest).Width() - Rungs->widths[Rungs->order[Rungs->next]];
+		}
+		if( (context->budget != NULL) && (context->budget->seams > 0) )
+		{
+			left = MIN( left, context->budget->seams );
+		}
 
-			(*Dest)(x,y).red = (CML_byte)value;
-			(*Dest)(x,y).green = (CML_byte)value;
-			(*Dest)(x,y).blue = (CML_byte)value;
-			(*Dest)(x,y).alpha = (*Source)(x,y).alpha;
+		//a band reports for all of the bands, since it has no CAIR_callback of its own
+		Band_Progress( context );
+
+		//If you're going to maintain some sort of progress counter/bar, here's where you would do it!
+		if( (Cancelled( context ) == true) || ((CAIR_callback != NULL) && (CAIR_callback( (float)(i+seams_done)/total_seams ) == false)) )
+		{
+			delete[] Min_Path;
+			delete[] Batch;
+			delete[] Coarse_Min;
+			delete[] Last_Path;
+			return false;
 		}
-	}
 
-	Shutdown_Threads();
-} //end CAIR_V_Energy()
+		//each coarse path gives scale paths, and the coarse map has to be big enough to have a path through it
+		if( (band_paths == 0) && (context->replay != NULL) )
+		{
+			//the coarse path comes from the list instead
+			pyramid = true;
+			Next_Seam( context->replay, Coarse_Min );
+			band_x = context->replay->scale_x;
+			band_y = context->replay->scale_y;
+			coarse_width = context->replay->width;
+			coarse_height = context->replay->height;
+		}
+		else if( band_paths == 0 )
+		{
+			pyramid = (scale > 1) && ((*Dest).Width() / scale >= 3) && ((*Dest).Height() / scale >= 3);
+			if( (pyramid == true) && (coarse_ready == false) )
+			{
+				Coarse_Map( context, &Edge, Weights, &Coarse, scale );
+				coarse_ready = true;
+			}
+			if( (pyramid == true) && (Cancelled( context ) == false) )
+			{
+				Least_Path( &Coarse.Energy, &Coarse.Dir, Coarse_Min );
+				coarse_width = Coarse.Edge.Width();
+				coarse_height = Coarse.Edge.Height();
+			}
+		}
 
-//=========================================================================================================//
-//Simple function that generates the horizontal energy map of Source placing it into Dest.
-//All values are scaled down to their relative gray value. Weights are assumed all zero.
-void CAIR_H_Energy( CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest )
-{
-	CML_color Tsource( 1, 1 );
-	CML_color Tdest( 1, 1 );
+		//try near the last path first, and keep it if it's within local_threshold percent of the last full map's best
+		local = false;
+		if( (pyramid == false) && (reach > 0) && (have_last == true) )
+		{
+			Local_Energy.Resize_Width( (*Dest).Width() );
+			Local_Dir.Resize_Width( (*Dest).Width() );
+			int energy = 0;
+			if( Local_Path( &Edge, Weights, &Local_Energy, &Local_Dir, Costs, ener, Last_Path, reach, Min_Path, &energy ) == true )
+			{
+				local = ( energy <= global_best + ( (global_best < 0) ? -global_best : global_best ) * context->local_threshold / 100 );
+				path_energy = energy;
+			}
+		}
 
-	Tsource.Transpose( Source );
-	CAIR_V_Energy( &Tsource, conv, ener, &Tdest );
+		if( pyramid == true )
+		{
+			//no full energy map to keep up with, just the band
+			if( Cancelled( context ) == false )
+			{
+				path_energy = Refine_Path( &Edge, Weights, &Energy, &Dir, Costs, ener, Coarse_Min, band_x, band_y, coarse_width, coarse_height, band_paths, Min_Path );
+			}
+		}
+		else if( local == true )
+		{
+			//Min_Path is already the local one
+		}
+		else if( first_time == true )
+		{
+			global_best = Energy_Path( context, &Edge, Weights, &Energy, &Dir, Min_Path, ener, Costs, true );
+			path_energy = global_best;
+		}
+		else
+		{
+			//Remove_Path() already brought the energy up to date
+			global_best = Least_Path( &Energy, &Dir, Min_Path );
+			path_energy = global_best;
+		}
 
-	(*Dest).Transpose( &Tdest );
-}
+		//the rest is left to CAIR_Hybrid()'s resampler
+		if( (context->budget != NULL) && (Over_Budget( context->budget, path_energy, average ) == true) )
+		{
+			break;
+		}
 
-//=========================================================================================================//
-//Experimental automatic object removal.
-//Any area with a negative weight will be removed. This function has three modes, determined by the choice paramater.
-//AUTO will have the function count the veritcal and horizontal rows/columns and remove in the direction that has the least.
-//VERTICAL will force the function to remove all negative weights in the veritcal direction; likewise for HORIZONTAL.
-//Because some conditions may cause the function not to remove all negative weights in one pass, max_attempts lets the function
-//go through the remoal process as many times as you're willing.
-bool CAIR_Removal( CML_color * Source, CML_int * S_Weights, CAIR_direction choice, int max_attempts, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
-{
-	int negative_x = 0;
-	int negative_y = 0;
-	CML_color Temp( 1, 1 );
-	Temp = (*Source);
-	(*D_Weights) = (*S_Weights);
+		//the batch paths need a good energy map
+		if( Cancelled( context ) == true )
+		{
+			delete[] Min_Path;
+			delete[] Batch;
+			delete[] Coarse_Min;
+			delete[] Last_Path;
+			return false;
+		}
 
-	for( int i = 0; i < max_attempts; i++ )
-	{
-		negative_x = 0;
-		negative_y = 0;
+		int count = 1;
+		if( (Batch != NULL) && (left > 1) && (pyramid == false) && (local == false) )
+		{
+			//take as many paths as we can out of this energy map
+			count = Batch_Paths( context, &Energy, &Dir, Batch, MIN( context->batch_size, left ) );
+		}
 
-		//count how many negative columns exist
-		for( int x = 0; x < (*D_Weights).Width(); x++ )
+		if( count >= MIN( MIN( context->batch_size, BATCH_MIN ), left ) && (count > 1) )
 		{
-			for( int y = 0; y < (*D_Weights).Height(); y++ )
+			//from the right, so the ones to the left are still where they were
+			for( int p = count - 1; (p >= 0) && (context->record != NULL); p-- )
 			{
-				if( (*D_Weights)(x,y) < 0 )
-				{
-					negative_x++;
-					break; //only breaks the inner loop
-				}
+				Record_Path( context->record, &Batch[p], (*Dest).Height(), count );
 			}
-		}
+			Remove_Batch( context, Dest, Batch, count, Weights, Index );
 
-		//count how many negative rows exist
-		for( int y = 0; y < (*D_Weights).Height(); y++ )
+			//and start over on everything else
+			Grayscale.Resize_Width( (*Dest).Width() );
+			Edge.Resize_Width( (*Dest).Width() );
+			Costs = Setup_Costs( &Cost_Map, ener, (*Dest).Width(), (*Dest).Height() );
+			Grayscale_Image( context, Dest, &Grayscale );
+			Edge_Detect( context, &Grayscale, &Edge, conv, Costs );
+
+			first_time = true;
+			have_last = false;
+		}
+		else if( (pyramid == false) && (local == true) )
 		{
-			for( int x = 0; x < (*D_Weights).Width(); x++ )
+			if( context->record != NULL )
 			{
-				if( (*D_Weights)(x,y) < 0 )
-				{
-					negative_y++;
-					break;
-				}
+				Record_Path( context->record, Min_Path, (*Dest).Height(), 1 );
 			}
-		}
 
-		switch( choice )
+			//like the pyramid, the full energy map is left behind until a path isn't found close by
+			Remove_Path( context, Dest, Min_Path, Weights, &Edge, &Grayscale, NULL, &Dir, Costs, Index, conv );
+			Energy.Resize_Width( (*Dest).Width() );
+			Dir.Resize_Width( (*Dest).Width() );
+			first_time = true;
+			count = 1;
+		}
+		else if( pyramid == true )
 		{
-		case AUTO :
-			//remove in the direction that has the least to remove
-			if( negative_y < negative_x )
+			if( context->record != NULL )
 			{
-				if( CAIR( &Temp, D_Weights, Temp.Width(), Temp.Height() - negative_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
-				{
-					return false;
-				}
-				Temp = (*Dest);
+				Record_Path( context->record, Min_Path, (*Dest).Height(), 1 );
 			}
-			else
+			Remove_Path( context, Dest, Min_Path, Weights, &Edge, &Grayscale, NULL, &Dir, Costs, Index, conv );
+			Energy.Resize_Width( (*Dest).Width() );
+			Dir.Resize_Width( (*Dest).Width() );
+			first_time = true; //for when the image gets too small for the pyramid
+			count = 1;
+
+			//once the band has given all its paths, the coarse map has shifted over by one block
+			band_paths++;
+			if( (band_paths == band_x) && (context->replay != NULL) )
 			{
-				if( CAIR( &Temp, D_Weights, Temp.Width() - negative_x, Temp.Height(), add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
-				{
-					return false;
-				}
-				Temp = (*Dest);
+				context->replay->width--;
+				band_paths = 0;
 			}
-			break;
-
-		case HORIZONTAL :
-			if( CAIR( &Temp, D_Weights, Temp.Width(), Temp.Height() - negative_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
+			else if( band_paths == band_x )
 			{
-				return false;
+				Coarse_Update( &Edge, Weights, &Coarse, Coarse_Min, scale );
+				band_paths = 0;
+			}
+		}
+		else
+		{
+			if( context->record != NULL )
+			{
+				Record_Path( context->record, Min_Path, (*Dest).Height(), 1 );
 			}
-			Temp = (*Dest);
-			break;
 
-		case VERTICAL :
-			if( CAIR( &Temp, D_Weights, Temp.Width() - negative_x, Temp.Height(), add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
+			//too few to be worth it, so just the best one
+			Remove_Path( context, Dest, Min_Path, Weights, &Edge, &Grayscale, &Energy, &Dir, Costs, Index, conv );
+			first_time = false;
+			count = 1;
+		}
+
+		if( (context->budget != NULL) && (context->budget->seams > 0) )
+		{
+			context->budget->seams -= MIN( count, context->budget->seams );
+		}
+
+		if( (count == 1) && (reach > 0) )
+		{
+			for( int y = 0; y < (*Dest).Height(); y++ )
 			{
-				return false;
+				Last_Path[y] = Min_Path[y];
 			}
-			Temp = (*Dest);
-			break;
+			have_last = ( pyramid == false );
+		}
+		i += count;
+		if( context->share != NULL )
+		{
+			context->share->removed += count;
 		}
 	}
 
-	//now expand back out to the origional
-	return CAIR( &Temp, D_Weights, (*Source).Width(), (*Source).Height(), add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
-} //end CAIR_Removal()
+	delete[] Min_Path;
+	delete[] Batch;
+	delete[] Coarse_Min;
+	delete[] Last_Path;
+
+	//the last rung is where we stopped
+	if( Rungs != NULL )
+	{
+		return Take_Rungs( Rungs, Dest, Weights );
+	}
+	return true;
+} //end CAIR_Remove()
 
 //=========================================================================================================//
-//Precompute removals in the x direction. Map will hold the largest width the corisponding pixel is still visible.
-//This will calculate all removals down to 3 pixels in width.
-//Right now this only performs removals and only the x-direction. For the future enlarging is planned. Precomputing for both directions
-//doesn't work all that well and generates significant artifacts. This function is intended for "content-aware multi-size images" as mentioned
-//in the doctors' presentation. The next logical step would be to encode Map into an existing image format. Then, using a function like
-//CAIR_Map_Resize() the image can be resized on a client machine with very little overhead.
-void CAIR_Image_Map( CML_color * Source, CML_int * Weights, CAIR_convolution conv, CAIR_energy ener, CML_int * Map )
+//Calls the CAIR_callback of the context that split this one up into bands, with how far all of the bands have got together.
+//The bands call this from their own threads, so it's skipped if another band is already in there. If the callback returns false,
+//every band sees it through Cancelled() and stops. Does nothing if this context isn't carving a band.
+void Band_Progress( CAIR_Context * context )
 {
-	Startup_Threads();
-	Resize_Threads( (*Source).Height() );
-
-	(*Map).D_Resize( (*Source).Width(), (*Source).Height() );
-	(*Map).Fill( 0 );
+	Band_Share * share = context->share;
+	if( (share == NULL) || (share->CAIR_callback == NULL) || (pthread_mutex_trylock( &(share->callback_lock) ) != 0) )
+	{
+		return;
+	}
+	if( (share->declined == false) && (share->CAIR_callback( (float)(share->removed + share->seams_done) / share->total_seams ) == false) )
+	{
+		share->declined = true;
+	}
+	pthread_mutex_unlock( &(share->callback_lock) );
+}
 
-	CML_color Temp( 1, 1 );
-	Temp = (*Source);
-	CML_int Temp_Weights( 1, 1 );
-	Temp_Weights = (*Weights); //don't change Weights since there is no change to the image
+//=========================================================================================================//
+//Carves the bands from top_y to bot_y, each one with its own context on this thread.
+void Band_Task( CAIR_Context * context, int num )
+{
+	Thread_Params band_area = context->thread_info[num];
 
-	for( int i = Temp.Width(); i > 3; i-- ) //3 is the minimum safe amount with 3x3 convolution kernels without causing problems
+	for( int b = band_area.top_y; b < band_area.bot_y; b++ )
 	{
-		//grayscale
-		CML_gray Grayscale( Temp.Width(), Temp.Height() );
-		Grayscale_Image( &Temp, &Grayscale );
+		Band_Carve * Carve = &(band_area.Carve[b]);
+		int goal = Carve->Source.Width() - Carve->removes;
 
-		//edge detect
-		CML_int Edge( Temp.Width(), Temp.Height() );
-		Edge_Detect( &Grayscale, &Edge, conv );
-
-		//find the energy values
-		int * Path = new int[(*Source).Height()];
-		CML_int Energy( Temp.Width(), Temp.Height() );
-		Energy_Path( &Edge, &Temp_Weights, &Energy, Path, ener, true );
+		Startup_Threads( Carve->context, Carve->Source.Width(), Carve->Source.Height() );
+		Carve->result = ( Cancelled( context ) == false ) &&
+			CAIR_Remove( Carve->context, &(Carve->Source), &(Carve->Weights), goal, band_area.conv, band_area.ener, &(Carve->Dest), NULL, 1, 0, NULL, NULL );
+	}
+}
 
-		Remove_Path( &Temp, Path, &Temp_Weights, &Edge, &Grayscale, &Energy, conv );
+//=========================================================================================================//
+//Mixes other into pixel, by mix parts out of parts.
+inline CML_RGBA Blend_Pixels( CML_RGBA pixel, CML_RGBA other, int mix, int parts )
+{
+	CML_RGBA blend;
+	blend.red = (CML_byte)( ( pixel.red * (parts - mix) + other.red * mix ) / parts );
+	blend.green = (CML_byte)( ( pixel.green * (parts - mix) + other.green * mix ) / parts );
+	blend.blue = (CML_byte)( ( pixel.blue * (parts - mix) + other.blue * mix ) / parts );
+	blend.alpha = (CML_byte)( ( pixel.alpha * (parts - mix) + other.alpha * mix ) / parts );
+	return blend;
+}
 
-		//now set the corisponding map value with the resolution
-		for( int y = 0; y < Temp.Height(); y++ )
-		{
-			int index = 0;
-			int offset = Path[y];
+//=========================================================================================================//
+//Hands out the paths to the bands. The removes lowest energy columns of the image stand in for where the paths would go, and each
+//band gets as many as fall inside it (not counting what it borrows). A band always keeps a column of its own, and whatever doesn't
+//fit is handed out to the bands with room left.
+void Share_Paths( CML_int * Edge, CML_int * Weights, Band_Carve * Carves, int bands, int removes )
+{
+	int width = (*Edge).Width();
+	long long * Columns = new long long[width];
+	long long * Sorted = new long long[width];
+	for( int x = 0; x < width; x++ )
+	{
+		Columns[x] = 0;
+	}
+	for( int y = 0; y < (*Edge).Height(); y++ )
+	{
+		int * Edge_Row = &(*Edge)(0,y);
+		int * Weight_Row = &(*Weights)(0,y);
+		for( int x = 0; x < width; x++ )
+		{
+			Columns[x] += Edge_Row[x] + Weight_Row[x];
+		}
+	}
+	for( int x = 0; x < width; x++ )
+	{
+		Sorted[x] = Columns[x];
+	}
+	std::nth_element( Sorted, Sorted + (removes - 1), Sorted + width );
+	long long highest = Sorted[removes - 1];
 
-			while( (*Map)(index,y) != 0 ) index++; //find the pixel that is in location zero (first unused)
-			while( offset > 0 )
+	//everything under the highest, then ties from the left until there are enough
+	int ties = removes;
+	for( int x = 0; x < width; x++ )
+	{
+		if( Columns[x] < highest )
+		{
+			ties--;
+		}
+	}
+
+	int given = 0;
+	for( int b = 0; b < bands; b++ )
+	{
+		int own = Carves[b].Source.Width() - Carves[b].left - Carves[b].right;
+		int first = Carves[b].start + Carves[b].left;
+		int count = 0;
+		for( int x = first; x < first + own; x++ )
+		{
+			if( Columns[x] < highest )
 			{
-				if( (*Map)(index,y) == 0 ) //find the correct x index
+				count++;
+			}
+			else if( (Columns[x] == highest) && (ties > 0) )
+			{
+				count++;
+				ties--;
+			}
+		}
+
+		Carves[b].removes = MIN( count, own - 1 );
+		given += Carves[b].removes;
+	}
+
+	//the leftovers from bands that were too narrow for their share
+	while( given < removes )
+	{
+		for( int b = 0; (b < bands) && (given < removes); b++ )
+		{
+			if( Carves[b].removes < Carves[b].Source.Width() - Carves[b].left - Carves[b].right - 1 )
+			{
+				Carves[b].removes++;
+				given++;
+			}
+		}
+	}
+
+	delete[] Columns;
+	delete[] Sorted;
+}
+
+//=========================================================================================================//
+//Removes the paths with CAIR_Bands() on, or hands everything to CAIR_Remove() when it's off or the image is too narrow for it.
+//Each band is carved on its own (see Band_Task()) with a wall of weight on the columns it borrows, so its paths stay inside it.
+//Then the bands are put back side by side, and each one is faded into the borrowed columns of its neighbors to hide the seam
+//between them. Weights (D_Weights) comes back carved the same way, without the fade.
+bool Remove_Bands( CAIR_Context * context, CML_color * Source, CML_int * Weights, int goal_x, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done )
+{
+	int bands = context->split_bands;
+	int overlap = context->band_overlap;
+	int width = (*Source).Width();
+	int height = (*Source).Height();
+	int removes = width - goal_x;
+	if( (bands < 2) || (context->record != NULL) || (context->replay != NULL) || (width / bands < MAX( 2 * overlap, 2 )) || (removes > width - bands) )
+	{
+		return CAIR_Remove( context, Source, Weights, goal_x, conv, ener, Dest, CAIR_callback, total_seams, seams_done, NULL, NULL );
+	}
+
+	//the bands and what each borrows
+	Band_Carve * Carves = new Band_Carve[bands];
+	for( int b = 0; b < bands; b++ )
+	{
+		int first = b * width / bands;
+		int last = (b + 1) * width / bands;
+		Carves[b].left = MIN( overlap, first );
+		Carves[b].right = MIN( overlap, width - last );
+		Carves[b].start = first - Carves[b].left;
+	}
+	for( int b = 0; b < bands; b++ )
+	{
+		int last = (b + 1) * width / bands;
+		int band_width = last + Carves[b].right - Carves[b].start;
+		Carves[b].Source.D_Resize( band_width, height );
+		Carves[b].Weights.D_Resize( band_width, height );
+	}
+
+	//each band gets its share of the paths from the edges
+	{
+		CML_gray Grayscale( width, height );
+		CML_int Edge( width, height );
+		Grayscale_Image( context, Source, &Grayscale );
+		Edge_Detect( context, &Grayscale, &Edge, conv, NULL );
+		Share_Paths( &Edge, Weights, Carves, bands, removes );
+	}
+
+	//so our cancel and callback still reach the bands
+	Band_Share share;
+	share.parent = context;
+	share.CAIR_callback = CAIR_callback;
+	share.total_seams = total_seams;
+	share.seams_done = seams_done;
+	share.removed = 0;
+	share.declined = false;
+	pthread_mutex_init( &(share.callback_lock), NULL );
+
+	//a wall of weight on the borrowed columns, as much as a whole path can take without running over (the pyramid sums it in blocks)
+	int wall = ( INT_MAX / 4 ) / ( height * context->pyramid_scale );
+	for( int b = 0; b < bands; b++ )
+	{
+		int band_width = Carves[b].Source.Width();
+		for( int y = 0; y < height; y++ )
+		{
+			memcpy( &(Carves[b].Source(0,y)), &(*Source)(Carves[b].start,y), band_width * sizeof(CML_RGBA) );
+			memcpy( &(Carves[b].Weights(0,y)), &(*Weights)(Carves[b].start,y), band_width * sizeof(int) );
+			for( int x = 0; x < Carves[b].left; x++ )
+			{
+				Carves[b].Weights(x,y) = wall;
+			}
+			for( int x = band_width - Carves[b].right; x < band_width; x++ )
+			{
+				Carves[b].Weights(x,y) = wall;
+			}
+		}
+
+		//one thread for each band, with the same settings as ours
+		Carves[b].context = CAIR_Create_Context();
+		CAIR_Threads( Carves[b].context, 1 );
+		CAIR_Batch( Carves[b].context, context->batch_size, context->batch_quality );
+		CAIR_Pyramid( Carves[b].context, context->pyramid_scale );
+		CAIR_Local( Carves[b].context, context->local_reach, context->local_threshold );
+		Carves[b].context->share = &share;
+		Carves[b].result = false;
+	}
+
+	//hand the bands out between the tasks
+	int tasks = MIN( bands, context->num_strips );
+	for( int i = 0; i < tasks; i++ )
+	{
+		context->thread_info[i].Carve = Carves;
+		context->thread_info[i].conv = conv;
+		context->thread_info[i].ener = ener;
+		context->thread_info[i].top_y = i * bands / tasks;
+		context->thread_info[i].bot_y = (i + 1) * bands / tasks;
+	}
+	Run_Tasks( context, Band_Task, tasks );
+	pthread_mutex_destroy( &(share.callback_lock) );
+
+	bool result = ( share.declined == false );
+	for( int b = 0; b < bands; b++ )
+	{
+		result = result && Carves[b].result;
+		CAIR_Destroy_Context( Carves[b].context );
+	}
+
+	if( result == true )
+	{
+		//put what each band kept of its own columns back together
+		(*Dest).D_Resize( goal_x, height );
+		(*Weights).D_Resize( goal_x, height );
+		int x = 0;
+		for( int b = 0; b < bands; b++ )
+		{
+			int own = Carves[b].Dest.Width() - Carves[b].left - Carves[b].right;
+			for( int y = 0; y < height; y++ )
+			{
+				memcpy( &(*Dest)(x,y), &(Carves[b].Dest(Carves[b].left,y)), own * sizeof(CML_RGBA) );
+				memcpy( &(*Weights)(x,y), &(Carves[b].Weights(Carves[b].left,y)), own * sizeof(int) );
+			}
+			x += own;
+
+			//fade into the next band on both sides of where they meet, half and half right at the join
+			if( b == bands - 1 )
+			{
+				break;
+			}
+			Band_Carve * Next = &(Carves[b+1]);
+			int next_own = (*Next).Dest.Width() - (*Next).left - (*Next).right;
+			int fade = MIN( MIN( Carves[b].right, (*Next).left ), MIN( own, next_own ) / 2 );
+			for( int y = 0; y < height; y++ )
+			{
+				for( int d = 0; d < fade; d++ )
 				{
-					offset--;
+					//our last columns, against what the next band borrowed from us
+					(*Dest)(x-1-d,y) = Blend_Pixels( (*Dest)(x-1-d,y), (*Next).Dest((*Next).left-1-d,y), fade - d, 2 * fade );
+				}
+			}
+			for( int y = 0; y < height; y++ )
+			{
+				int borrowed = Carves[b].Dest.Width() - Carves[b].right;
+				for( int d = 0; d < fade; d++ )
+				{
+					//its first columns, against what we borrowed from it
+					(*Dest)(x+d,y) = Blend_Pixels( (*Next).Dest((*Next).left+d,y), Carves[b].Dest(borrowed+d,y), fade - d, 2 * fade );
 				}
-				index++;
 			}
-			while( (*Map)(index,y) != 0 ) index++; //if the current and subsequent pixels have been removed
-
-			(*Map)(index,y) = i; //this is now the smallest resolution this pixel will be visible
 		}
+	}
 
-		delete[] Path;
+	delete[] Carves;
+
+	if( (result == false) || (Cancelled( context ) == true) ||
+		((CAIR_callback != NULL) && (CAIR_callback( (float)(removes+seams_done)/total_seams ) == false)) )
+	{
+		return false;
 	}
+	return true;
+} //end Remove_Bands()
 
-	Shutdown_Threads();
-} //end CAIR_Image_Map()
+//=========================================================================================================//
+//Duplicates the paths found by CAIR_Add_Seams() into Source and Weights in one pass. Index has the original columns of the pixels
+//that were kept, so every column not in it gets added. Source and Weights must have the room Reserve()'ed.
+void Insert_Seams( CAIR_Context * context, CML_color * Source, CML_int * Weights, CML_int * Index )
+{
+	int thread_height = (*Source).Height() / context->num_strips;
+
+	//setup parameters
+	for( int i = 0; i < context->num_strips; i++ )
+	{
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].Index = Index;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
+	}
+
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_y = (*Source).Height();
+
+	Run_Tasks( context, Insert_Seams_Task, context->num_strips );
+
+	(*Source).Resize_Width( (*Source).Width() + ((*Source).Width() - (*Index).Width()) );
+	(*Weights).Resize_Width( (*Source).Width() );
+}
 
 //=========================================================================================================//
-//An "example" function on how to decode the Map to quickly resize an image. This is only for the width, since multi-directional
-//resizing produces significant artifacts. Do note this will produce different results than standard CAIR(), because this resize doesn't
-//average pixels back into the image as does CAIR(). This function could be multi-threaded much like Remove_Path() for even faster performance.
-void CAIR_Map_Resize( CML_color * Source, CML_int * Map, int goal_x, CML_color * Dest )
+//Adds paths to Source the way the paper describes, storing the result in Dest.
+//The paths are found by removing them from a copy of the image with CAIR_Remove(), all the while keeping track of which original
+//columns are left. Then every removed column is duplicated at once with Insert_Seams(). Since the paths come out of the image,
+//no more than half of the width is added in each round. There is no add_weight here; the paths can't be chosen twice in a round.
+bool CAIR_Add_Seams( CAIR_Context * context, CML_color * Source, CML_int * Weights, int goal_x, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, bool (*CAIR_callback)(float), int total_seams, int seams_done )
 {
-	(*Dest).D_Resize( goal_x, (*Source).Height() );
+	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
+	(*Dest).Reserve( goal_x, (*Source).Height() );
+	Reserve_Weights( Weights, goal_x );
+	Copy_Reserved( Source, Dest );
 
-	for( int y = 0; y < (*Source).Height(); y++ )
+	CML_color Temp( 1, 1 );
+	CML_int Temp_Weights( 1, 1 );
+	CML_int Index( 1, 1 );
+
+	while( (*Dest).Width() < goal_x )
 	{
-		int input_x = 0; //map the Source's pixels to the Dests smaller size
-		for( int x = 0; x < goal_x; x++ )
+		int adds = MIN( goal_x - (*Dest).Width(), (*Dest).Width() / 2 );
+
+		Index.D_Resize( (*Dest).Width(), (*Dest).Height() );
+		for( int y = 0; y < Index.Height(); y++ )
 		{
-			while( (*Map)(input_x,y) > goal_x ) input_x++; //skip past pixels not in this resolution
+			for( int x = 0; x < Index.Width(); x++ )
+			{
+				Index(x,y) = x;
+			}
+		}
+		Temp_Weights = (*Weights); //the real weights aren't losing anything
 
-			(*Dest)(x,y) = (*Source)(input_x,y);
-			input_x++;
+		if( CAIR_Remove( context, Dest, &Temp_Weights, (*Dest).Width() - adds, conv, ener, &Temp, CAIR_callback, total_seams, seams_done, &Index, NULL ) == false )
+		{
+			return false;
+		}
+		seams_done += adds;
+
+		Insert_Seams( context, Dest, Weights, &Index );
+	}
+
+	return true;
+} //end CAIR_Add_Seams()
+
+//=========================================================================================================//
+//Waits on sem, but checks on it for a while before letting the kernel put us to sleep.
+inline void Spin_Wait( CAIR_Context * context, sem_t * sem )
+{
+	for( int i = 0; i < context->spin_count; i++ )
+	{
+		if( sem_trywait( sem ) == 0 )
+		{
+			return;
 		}
 	}
+	sem_wait( sem );
 }
 
 //=========================================================================================================//
-//==                                             C A I R  H D                                            ==//
+//Locks mutex, but tries it for a while before letting the kernel put us to sleep.
+inline void Spin_Lock( CAIR_Context * context, pthread_mutex_t * mutex )
+{
+	for( int i = 0; i < context->spin_count; i++ )
+	{
+		if( pthread_mutex_trylock( mutex ) == 0 )
+		{
+			return;
+		}
+	}
+	pthread_mutex_lock( mutex );
+}
+
 //=========================================================================================================//
-//This works as CAIR, except here maximum quality is attempted. When removing in both directions some amount, CAIR_HD()
-//will determine which direction has the least amount of energy and then removes in that direction. This is only done
-//for removal, since enlarging will not benifit, although this function will perform addition just like CAIR().
-//Inputs are the same as CAIR().
-bool CAIR_HD( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+//Takes the next task of the current set and runs it. Returns false if they've all been taken.
+//Pinned workers take every pool_threads'th task starting at their own number, so each strip of the image is always worked on
+//by the same thread, on the same core. Otherwise whoever is free takes the next one, and worker is not used.
+//The task_lock must be held, and is held again on return.
+bool Take_Task( CAIR_Context * context, int worker )
 {
-	Startup_Threads();
+	int * next = &(context->task_next);
+	int step = 1;
+	if( context->pool_pinned == true )
+	{
+		next = &(context->worker_next[worker]);
+		step = context->pool_threads;
+	}
 
-	//if no change, then just copy to the source to the destination
-	if( (goal_x == (*Source).Width()) && (goal_y == (*Source).Height() ) )
+	if( *next >= context->task_count )
 	{
-		(*Dest) = (*Source);
-		(*D_Weights) = (*S_Weights);
-		return true;
+		return false;
 	}
 
-	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
-	int seams_done = 0;
+	int num = *next;
+	*next += step;
+	void (*task)( CAIR_Context * context, int num ) = context->task;
 
-	CML_color Temp( 1, 1 );
-	CML_color TTemp( 1, 1 );
+	//do the work without holding everyone else up
+	pthread_mutex_unlock( &(context->task_lock) );
+	task( context, num );
+	pthread_mutex_lock( &(context->task_lock) );
 
-	//to start the loop
-	(*Dest) = (*Source);
-	(*D_Weights) = (*S_Weights);
+	context->task_left--;
+	if( (context->task_left == 0) && (context->finish_asleep == true) )
+	{
+		pthread_cond_broadcast( &(context->task_done) );
+	}
+	return true;
+}
 
-	//do this loop when we can remove in either direction
-	while( ((*Dest).Width() > goal_x) && ((*Dest).Height() > goal_y) )
+//=========================================================================================================//
+//Pins the calling worker to one core, spreading the workers evenly over the cores we're allowed to use. Numbering the cores
+//one socket after the other is the common case, so that also spreads them evenly over the sockets.
+//Only Linux has a way to do this, so elsewhere the workers are left wherever the system puts them.
+void Pin_Thread( CAIR_Context * context, int worker )
+{
+#ifdef __linux__
+	cpu_set_t allowed;
+	if( sched_getaffinity( 0, sizeof(allowed), &allowed ) != 0 )
 	{
-		Temp = (*Dest);
-		TTemp.Transpose( Dest );
+		return;
+	}
 
-		//grayscale the normal and transposed
-		CML_gray Grayscale( Temp.Width(), Temp.Height() );
-		CML_gray TGrayscale( TTemp.Width(), TTemp.Height() );
-		Grayscale_Image( &Temp, &Grayscale );
-		Grayscale_Image( &TTemp, &TGrayscale );
+	int pick = ( worker * CPU_COUNT( &allowed ) ) / context->pool_threads;
+	for( int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+	{
+		if( CPU_ISSET( cpu, &allowed ) )
+		{
+			if( pick == 0 )
+			{
+				cpu_set_t mine;
+				CPU_ZERO( &mine );
+				CPU_SET( cpu, &mine );
+				pthread_setaffinity_np( pthread_self(), sizeof(mine), &mine );
+				return;
+			}
+			pick--;
+		}
+	}
+#endif
+}
 
-		//edge detect
-		CML_int Edge( Temp.Width(), Temp.Height() );
-		CML_int TEdge( TTemp.Width(), TTemp.Height() );
-		Edge_Detect( &Grayscale, &Edge, conv );
-		Edge_Detect( &TGrayscale, &TEdge, conv );
+//=========================================================================================================//
+//The worker threads. Every stage of CAIR hands them a set of tasks, usually one for each strip of the image, and the workers
+//take them one at a time until there are none left. A worker that finishes early just takes another strip.
+void * Worker_Thread( void * id )
+{
+	CAIR_Context * context = (CAIR_Context *)id;
 
-		//find the energy values
-		CML_int TWeights( 1, 1 );
-		TWeights.Transpose( D_Weights );
-		int * Path = new int[Temp.Height()];
-		int * TPath = new int[TTemp.Height()];
-		CML_int Energy( Temp.Width(), Temp.Height() );
-		CML_int TEnergy( TTemp.Width(), TTemp.Height() );
-		Resize_Threads( Temp.Height() );
-		int energy_x = Energy_Path( &Edge, D_Weights, &Energy, Path, ener, true );
-		Resize_Threads( TTemp.Height() );
-		int energy_y = Energy_Path( &TEdge, &TWeights, &TEnergy, TPath, ener, true );
+	pthread_mutex_lock( &(context->task_lock) );
+	int worker = context->workers_up;
+	context->workers_up++;
+	if( context->pool_pinned == true )
+	{
+		Pin_Thread( context, worker );
+	}
 
-		if( energy_y < energy_x )
+	while( context->exit == false )
+	{
+		if( Take_Task( context, worker ) == true )
 		{
-			Remove_Path( &TTemp, TPath, &TWeights, &TEdge, &TGrayscale, &TEnergy, conv );
-			(*Dest).Transpose( &TTemp );
-			(*D_Weights).Transpose( &TWeights );
+			continue;
 		}
-		else
+
+		//wait for the next set, which is usually right around the corner, so check on it for a while first
+		int round = context->task_round;
+		pthread_mutex_unlock( &(context->task_lock) );
+		for( int i = 0; (i < context->spin_count) && (context->task_round == round); i++ );
+		pthread_mutex_lock( &(context->task_lock) );
+
+		context->sleepers++;
+		while( (context->task_round == round) && (context->exit == false) )
 		{
-			Remove_Path( &Temp, Path, D_Weights, &Edge, &Grayscale, &Energy, conv );
-			(*Dest) = Temp;
+			pthread_cond_wait( &(context->task_ready), &(context->task_lock) );
 		}
+		context->sleepers--;
+	}
+	pthread_mutex_unlock( &(context->task_lock) );
 
-		delete[] Path;
-		delete[] TPath;
+	return NULL;
+} //end Worker_Thread()
+
+//=========================================================================================================//
+//Runs the current task for an executor that only passes along data and num (see CAIR_Executor()).
+void Backend_Task( void * data, int num )
+{
+	CAIR_Context * context = (CAIR_Context *)data;
+	context->task( context, num );
+}
+
+//=========================================================================================================//
+//The STD_THREADS backend's threads, which take the next task until there are none left.
+void Std_Thread( CAIR_Context * context, std::atomic<int> * next )
+{
+	for( int num = (*next)++; num < context->task_count; num = (*next)++ )
+	{
+		context->task( context, num );
+	}
+}
+
+//=========================================================================================================//
+//Runs count tasks to the end with whatever is running them instead of our pool (see CAIR_Backend() and CAIR_Executor()).
+//The calling thread does them all itself for a small image (see Pick_Threads()), or with the SERIAL backend.
+void Run_Backend( CAIR_Context * context, void (*task)( CAIR_Context * context, int num ), int count )
+{
+	context->task = task;
+	context->task_count = count;
 
-		if( (CAIR_callback != NULL) && (CAIR_callback( (float)(seams_done)/total_seams ) == false) )
+	if( context->run_threads == 0 )
+	{
+		for( int i = 0; i < count; i++ )
 		{
-			Shutdown_Threads();
-			return false;
+			task( context, i );
+		}
+	}
+	else if( context->executor != NULL )
+	{
+		context->executor( Backend_Task, context, count, context->executor_host );
+	}
+	else if( context->backend == STD_THREADS )
+	{
+		//we make one of the threads
+		std::atomic<int> next( 0 );
+		std::thread * threads = new std::thread[context->run_threads - 1];
+		for( int i = 0; i < context->run_threads - 1; i++ )
+		{
+			threads[i] = std::thread( Std_Thread, context, &next );
+		}
+		Std_Thread( context, &next );
+		for( int i = 0; i < context->run_threads - 1; i++ )
+		{
+			threads[i].join();
+		}
+		delete[] threads;
+	}
+	else //OPENMP
+	{
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic) num_threads(context->run_threads)
+#endif
+		for( int i = 0; i < count; i++ )
+		{
+			task( context, i );
 		}
-		seams_done++;
 	}
+}
 
-	//one dimension is the now on the goal, so finish off the other direction
-	Temp = (*Dest);
-	Shutdown_Threads();
-	return CAIR( &Temp, D_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
-} //end CAIR_HD()
+//=========================================================================================================//
+//Hands the workers count tasks, running task( context, num ) for each num from 0 to count - 1. This returns right away,
+//so we can do something else while they work. Finish_Tasks() must be called before the next set is handed out.
+//Without our pool (see Startup_Threads()) the tasks are all done before this returns instead (see Run_Backend()).
+void Start_Tasks( CAIR_Context * context, void (*task)( CAIR_Context * context, int num ), int count )
+{
+	if( context->pooled == false )
+	{
+		Run_Backend( context, task, count );
+		return;
+	}
+
+	pthread_mutex_lock( &(context->task_lock) );
+	context->task = task;
+	context->task_count = count;
+	context->task_next = 0;
+	context->task_left = count;
+	if( context->pool_pinned == true )
+	{
+		for( int i = 0; i < context->pool_threads; i++ )
+		{
+			context->worker_next[i] = i;
+		}
+	}
+	context->task_round++;
+	if( context->sleepers > 0 )
+	{
+		pthread_cond_broadcast( &(context->task_ready) );
+	}
+	pthread_mutex_unlock( &(context->task_lock) );
+}
+
+//=========================================================================================================//
+//Waits for the current set of tasks to be done, helping out with any that nobody has taken yet.
+void Finish_Tasks( CAIR_Context * context )
+{
+	if( context->pooled == false )
+	{
+		return; //Start_Tasks() already did them
+	}
+
+	//pinned workers keep their own strips, so we don't help
+	pthread_mutex_lock( &(context->task_lock) );
+	while( (context->pool_pinned == false) && (Take_Task( context, -1 ) == true) );
+	pthread_mutex_unlock( &(context->task_lock) );
+
+	//the last ones are usually almost done
+	for( int i = 0; (i < context->spin_count) && (context->task_left > 0); i++ );
+
+	pthread_mutex_lock( &(context->task_lock) );
+	context->finish_asleep = true;
+	while( context->task_left > 0 )
+	{
+		pthread_cond_wait( &(context->task_done), &(context->task_lock) );
+	}
+	context->finish_asleep = false;
+	pthread_mutex_unlock( &(context->task_lock) );
+}
+
+//=========================================================================================================//
+//Runs count tasks and waits for them all to be done.
+void Run_Tasks( CAIR_Context * context, void (*task)( CAIR_Context * context, int num ), int count )
+{
+	Start_Tasks( context, task, count );
+	Finish_Tasks( context );
+}
+
+//=========================================================================================================//
+//Picks how many threads an image of width by height should use, or zero to do it all on the calling thread.
+//Unless CAIR_Threads() set a count, that's one thread for each core (or as many as the executor or OpenMP has), but only as many
+//as the image has MIN_THREAD_PIXELS for.
+int Pick_Threads( CAIR_Context * context, int width, int height )
+{
+	if( (context->executor == NULL) && (context->backend == SERIAL) )
+	{
+		return 0;
+	}
+
+	int threads = context->num_threads;
+
+	if( threads == 0 )
+	{
+		threads = std::thread::hardware_concurrency();
+		if( context->executor != NULL )
+		{
+			threads = context->executor_threads;
+		}
+#ifdef _OPENMP
+		else if( context->backend == OPENMP )
+		{
+			threads = omp_get_max_threads();
+		}
+#endif
+		threads = (int)MIN( (double)threads, ((double)width * height) / MIN_THREAD_PIXELS );
+	}
+
+	//one thread is no better than the calling thread, and our pool's energy map needs two side by side
+	return ( threads < 2 ) ? 0 : threads;
+}
+
+//=========================================================================================================//
+//Deletes the strips made by Setup_Strips().
+void Free_Strips( CAIR_Context * context )
+{
+	if( context->strip_room == 0 )
+	{
+		return;
+	}
+
+	delete[] context->thread_info;
+	for( int i = 0; i < context->strip_room; i++ )
+	{
+		sem_destroy( &(context->remove_done[i]) );
+	}
+	delete[] context->remove_done;
+
+	context->thread_info = NULL;
+	context->remove_done = NULL;
+	context->strip_room = 0;
+	context->num_strips = 0;
+}
+
+//=========================================================================================================//
+//Makes room in thread_info and remove_done for count strips, and splits the stages into that many.
+void Setup_Strips( CAIR_Context * context, int count )
+{
+	if( context->strip_room >= count )
+	{
+		context->num_strips = count;
+		return;
+	}
+	Free_Strips( context );
+
+	context->num_strips = count;
+	context->strip_room = MAX( count, 2 ); //the energy map always takes two
+	context->thread_info = new Thread_Params[context->strip_room];
+	context->remove_done = new sem_t[context->strip_room];
+	for( int i = 0; i < context->strip_room; i++ )
+	{
+		sem_init( &(context->remove_done[i]), 0, 0 );
+	}
+}
+
+//=========================================================================================================//
+//Gets everything ready for an image of width by height. A small image is done serially by the calling thread (see Pick_Threads()).
+//So is everything run by another backend, which doesn't need anything started up (see Run_Backend()). Those don't leave our pool
+//sitting around either. Otherwise the workers are started, and stay up between calls. They are only restarted when more are needed, or if CAIR_Threads()
+//or CAIR_Affinity() changed, so a small image after a large one just uses fewer strips on the same workers.
+//NOTE: This does NOT create the mutexes for the energy threads! Use Resize_Threads() after this, to do that.
+void Startup_Threads( CAIR_Context * context, int width, int height )
+{
+	int threads = Pick_Threads( context, width, height );
+	context->run_threads = threads;
+	context->pooled = ( threads > 0 ) && ( context->executor == NULL ) && ( context->backend == PTHREADS );
+
+	if( context->pooled == false )
+	{
+		if( (context->pool_threads > 0) && ((context->executor != NULL) || (context->backend != PTHREADS)) )
+		{
+			Shutdown_Threads( context );
+		}
+		Setup_Strips( context, MAX( threads, 1 ) * STRIPS_PER_THREAD );
+		return;
+	}
+
+	if( (context->pool_threads < threads) || ((context->num_threads > 0) && (context->pool_threads != threads)) || (context->pool_pinned != context->pin) )
+	{
+		Shutdown_Threads( context );
+
+		//create semaphores
+		sem_init( &(context->energy_sem[0]), 0, 0 ); //locks_done
+		sem_init( &(context->energy_sem[1]), 0, 0 ); //good_to_go
+
+		//setup the task handout
+		pthread_mutex_init( &(context->task_lock), NULL );
+		pthread_cond_init( &(context->task_ready), NULL );
+		pthread_cond_init( &(context->task_done), NULL );
+		context->task_count = 0;
+		context->task_next = 0;
+		context->task_left = 0;
+		context->sleepers = 0;
+		context->finish_asleep = false;
+		context->exit = false;
+		context->spin_count = ( std::thread::hardware_concurrency() > 1 ) ? SPIN_COUNT : 0;
+		context->pool_pinned = context->pin;
+		context->worker_next = new int[threads];
+		for( int i = 0; i < threads; i++ )
+		{
+			context->worker_next[i] = 0; //nothing to take until the first set
+		}
+		context->workers_up = 0;
+		context->pool_threads = threads;
+
+		//startup the threads
+		context->workers = new pthread_t[threads];
+		for( int i = 0; i < threads; i++ )
+		{
+			pthread_create( &(context->workers[i]), NULL, Worker_Thread, context );
+		}
+	}
+
+	Setup_Strips( context, threads * STRIPS_PER_THREAD );
+}
+
+//=========================================================================================================//
+//Makes a new context with the default settings. Its threads aren't started until it's first used.
+CAIR_Context * CAIR_Create_Context()
+{
+	return new CAIR_Context;
+}
+
+//=========================================================================================================//
+//Stops the context's threads and deletes it.
+void CAIR_Destroy_Context( CAIR_Context * context )
+{
+	Shutdown_Threads( context );
+	delete context;
+}
+
+//=========================================================================================================//
+//Creates or resizes the arrays of mutexes for the two energy threads, depending on the height of the image.
+void Resize_Threads( CAIR_Context * context, int height )
+{
+	//the energy threads only lock anything on our pool
+	if( context->pooled == false )
+	{
+		height = 0;
+	}
+
+	if( context->Left_Mutexes != NULL )
+	{
+		//clear out and delete the left
+		for( int i = 0; i < context->mutex_height; i++ )
+		{
+			pthread_mutex_destroy( &(context->Left_Mutexes[i]) );
+		}
+
+		delete[] context->Left_Mutexes;
+	}
+	if( context->Right_Mutexes != NULL )
+	{
+		//clear out and delete the right
+		for( int i = 0; i < context->mutex_height; i++ )
+		{
+			pthread_mutex_destroy( &(context->Right_Mutexes[i]) );
+		}
+
+		delete[] context->Right_Mutexes;
+	}
+
+	//creat the new objects
+	if( height > 0 )
+	{
+		context->Left_Mutexes = new pthread_mutex_t[height];
+		context->Right_Mutexes = new pthread_mutex_t[height];
+	}
+	else
+	{
+		context->Left_Mutexes = NULL;
+		context->Right_Mutexes = NULL;
+	}
+
+	//init the mutexes
+	for( int i = 0; i < height; i++ )
+	{
+		pthread_mutex_init( &(context->Left_Mutexes[i]), NULL );
+		pthread_mutex_init( &(context->Right_Mutexes[i]), NULL );
+	}
+
+	context->mutex_height = height;
+}
+
+//=========================================================================================================//
+//Stops all threads. Deletes all semaphores and mutexes.
+void Shutdown_Threads( CAIR_Context * context )
+{
+	Free_Strips( context );
+
+	//let the mutexes begone!
+	Resize_Threads( context, 0 );
+
+	if( context->pool_threads == 0 )
+	{
+		return;
+	}
+
+	//notify the threads
+	pthread_mutex_lock( &(context->task_lock) );
+	context->exit = true;
+	context->task_round++;
+	pthread_cond_broadcast( &(context->task_ready) );
+	pthread_mutex_unlock( &(context->task_lock) );
+
+	//wait for the joins
+	for( int i = 0; i < context->pool_threads; i++ )
+	{
+		pthread_join( context->workers[i], NULL );
+	}
+
+	//remove the thread handles
+	delete[] context->workers;
+	delete[] context->worker_next;
+	context->worker_next = NULL;
+
+	//delete the semaphores
+	sem_destroy( &(context->energy_sem[0]) ); //locks_done
+	sem_destroy( &(context->energy_sem[1]) ); //good_to_go
+
+	pthread_mutex_destroy( &(context->task_lock) );
+	pthread_cond_destroy( &(context->task_ready) );
+	pthread_cond_destroy( &(context->task_done) );
+
+	context->pool_threads = 0;
+}
+
+//=========================================================================================================//
+//Set the number of threads that CAIR should use. Zero (the default) picks for each image, from the number of cores and the size
+//of the image (see Pick_Threads()). One does everything on the calling thread.
+//If the threads are already running, they're restarted with the new count on the next CAIR call.
+//WARNING: Never call this function while CAIR() is processing an image, otherwise bad things will happen!
+void CAIR_Threads( CAIR_Context * context, int thread_count )
+{
+	context->num_threads = MAX( thread_count, 0 );
+}
+
+//=========================================================================================================//
+//Pins the worker threads to cores, spread evenly over them, and keeps each strip of the image on the same worker from seam to seam.
+//The rows of each strip are also moved into memory allocated by its worker, which puts them on that worker's NUMA node.
+//Only pays off for large images on machines with more than one socket. The workers are restarted on the next call.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Affinity( CAIR_Context * context, bool pin )
+{
+	context->pin = pin;
+}
+
+//=========================================================================================================//
+//Picks what runs the tasks. Anything but PTHREADS shuts down our pool on the next call.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Backend( CAIR_Context * context, CAIR_backend backend )
+{
+	context->backend = backend;
+}
+
+//=========================================================================================================//
+//Has the host's executor run the tasks, which can run threads of them at once. A NULL executor goes back to CAIR_Backend().
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Executor( CAIR_Context * context, CAIR_executor executor, void * host, int threads )
+{
+	context->executor = executor;
+	context->executor_host = host;
+	context->executor_threads = MAX( threads, 1 );
+}
+
+//=========================================================================================================//
+//Sets up batch removal. With a size over 1, CAIR_Remove() takes up to size paths out of each energy map and removes them in one
+//pass. Only paths within quality percent of the best path's energy are taken. A size of 1 goes back to one path at a time.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Batch( CAIR_Context * context, int size, int quality )
+{
+	context->batch_size = MAX( size, 1 );
+	context->batch_quality = MAX( quality, 0 );
+}
+
+//=========================================================================================================//
+//Sets up the coarse to fine path search. With a scale over 1, CAIR_Remove() finds paths on a copy of the edges shrunk by scale,
+//and each one gives scale paths at full size from a band around it. A scale of 1 goes back to the full energy map.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Pyramid( CAIR_Context * context, int scale )
+{
+	context->pyramid_scale = MAX( scale, 1 );
+}
+
+//=========================================================================================================//
+//Sets up banded removal. With more than 1 band, CAIR() splits the image into that many bands, which borrow overlap columns from
+//each other, and carves them all at once (see Remove_Bands()). 1 band goes back to carving the whole image.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Bands( CAIR_Context * context, int bands, int overlap )
+{
+	context->split_bands = MAX( bands, 1 );
+	context->band_overlap = MAX( overlap, 0 );
+}
+
+//=========================================================================================================//
+//Sets up the local path search. With a reach over 0, CAIR_Remove() first looks for each path within reach columns of the last one,
+//and takes it if it's within threshold percent of the best path from the last full energy map. A reach of 0 turns it off.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Local( CAIR_Context * context, int reach, int threshold )
+{
+	context->local_reach = MAX( reach, 0 );
+	context->local_threshold = MAX( threshold, 0 );
+}
+
+//=========================================================================================================//
+//Picks how CAIR_Add() enlarges the image.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Add_Mode( CAIR_Context * context, CAIR_add_mode mode )
+{
+	context->add_mode = mode;
+}
+
+//=========================================================================================================//
+//Stops the threads that CAIR keeps running between calls, and frees their semaphores and mutexes.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image.
+void CAIR_Shutdown( CAIR_Context * context )
+{
+	Shutdown_Threads( context );
+}
+
+//=========================================================================================================//
+//==                                          F R O N T E N D                                            ==//
+//=========================================================================================================//
+//The Great CAIR Frontend. This baby will retarget Source using S_Weights into the dimensions supplied by goal_x and goal_y into D_Weights and Dest.
+//Weights allows for an area to be biased for removal/protection. A large positive value will protect a portion of the image,
+//and a large negative value will remove it. Do not exceed the limits of int's, as this will cause an overflow. I would suggest
+//a safe range of -2,000,000 to 2,000,000 (this is a maximum guideline, much smaller weights will work just as well for most images).
+//Weights must be the same size as Source. D_Weights will contain the weights of Dest after the resize. Dest is the output,
+//and as such has no constraints (its contents will be destroyed, just so you know). 
+//To prevent the same path from being chosen during an add, and to prevent merging paths from being chosen during an add, 
+//additional weight is placed to the old least-energy path and the new inserted path. Having  a very large add_weight 
+//will cause the algorithm to work more like a linear algorithm. Having a very small add_weight will cause stretching. 
+//A weight of greater than 25 should prevent stretching, but may not evenly distribute paths through an area. 
+//Note: Weights does affect path adding, so a large negative weight will attract the most paths. Also, if add_weight is too large,
+//it may eventually force new paths into areas marked for protection. I am unsure of an exact ratio on such things at this time.
+//The internal order is this: remove horizontal, remove vertical, add horizontal, add vertical.
+//CAIR can use multiple convolution methods to determine the image energy. 
+//Prewitt and Sobel are close to each other in results and represent the "traditional" edge detection.
+//V_SQUARE and V1 can produce some of the better quality results, but may remove from large objects to do so. Do note that V_SQUARE
+//produces much larger edge values, any may require larger weight values (by about an order of magnitude) for effective operation.
+//Laplacian is a second-derivative operator, and can limit some artifacts while generating others.
+//CAIR now can use the new improved energy algorithm called "forward energy." Removing seams can sometimes add energy back to the image
+//by placing nearby edges directly next to each other. Forward energy can get around this by determining the future cost of a seam.
+//Forward energy removes most serious artifacts from a retarget, but is slightly more costly in terms of performance.
+bool CAIR( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	//if no change, then just copy to the source to the destination
+	if( (goal_x == (*Source).Width()) && (goal_y == (*Source).Height() ) )
+	{
+		(*Dest) = (*Source);
+		(*D_Weights) = (*S_Weights);
+		return true;
+	}
+
+	//calculate the total number of operations needed
+	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
+	int seams_done = 0;
+
+	//create threads for the run
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	CML_color Temp( 1, 1 );
+	Temp = (*Source);
+	(*D_Weights) = (*S_Weights);
+
+	if( goal_x < (*Source).Width() )
+	{
+		if( Remove_Bands( context, Source, D_Weights, goal_x, conv, ener, Dest, CAIR_callback, total_seams, seams_done ) == false )
+		{
+			return false;
+		}
+		Temp = (*Dest);
+		seams_done += abs((*Source).Width()-goal_x);
+	}
+
+	if( goal_y < (*Source).Height() )
+	{
+		//remove horiztonal paths
+		//works like above, except hand it a rotated image AND weights
+		CML_color TSource( 1, 1 );
+		CML_color TDest( 1, 1 );
+		CML_int TWeights( 1, 1 );
+		TSource.Transpose( &Temp );
+		TWeights.Transpose( D_Weights );
+
+		if( Remove_Bands( context, &TSource, &TWeights, goal_y, conv, ener, &TDest, CAIR_callback, total_seams, seams_done ) == false )
+		{
+			return false;
+		}
+		
+		//store back the transposed info
+		(*Dest).Transpose( &TDest );
+		(*D_Weights).Transpose( &TWeights );
+		Temp = (*Dest);
+		seams_done += abs((*Source).Height()-goal_y);
+	}
+
+	if( goal_x > (*Source).Width() )
+	{
+		if( CAIR_Add( context, &Temp, D_Weights, goal_x, add_weight, conv, ener, Dest, CAIR_callback, total_seams, seams_done ) == false )
+		{
+			return false;
+		}
+		Temp = (*Dest); //incase we resize in the y direction
+		seams_done += abs((*Source).Width()-goal_x);
+	}
+	if( goal_y > (*Source).Height() )
+	{
+		//add horiztonal paths
+		//works like above, except hand it a rotated image
+		CML_color TSource( 1, 1 );
+		CML_color TDest( 1, 1 );
+		CML_int TWeights( 1, 1 );
+		TSource.Transpose( &Temp );
+		TWeights.Transpose( D_Weights );
+
+		if( CAIR_Add( context, &TSource, &TWeights, goal_y, add_weight, conv, ener, &TDest, CAIR_callback, total_seams, seams_done ) == false )
+		{
+			return false;
+		}
+		
+		//store back the transposed info
+		(*Dest).Transpose( &TDest );
+		(*D_Weights).Transpose( &TWeights );
+		seams_done += abs((*Source).Height()-goal_y);
+	}
+
+	return true;
+} //end CAIR()
+
+//=========================================================================================================//
+//==                                                E X T R A S                                          ==//
+//=========================================================================================================//
+//Simple function that generates the grayscale image of Source and places the result in Dest.
+void CAIR_Grayscale( CAIR_Context * context, CML_color * Source, CML_color * Dest )
+{
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	CML_gray gray( (*Source).Width(), (*Source).Height() );
+	Grayscale_Image( context, Source, &gray );
+
+	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
+
+	for( int x = 0; x < (*Source).Width(); x++ )
+	{
+		for( int y = 0; y < (*Source).Height(); y++ )
+		{
+			(*Dest)(x,y).red = gray(x,y);
+			(*Dest)(x,y).green = gray(x,y);
+			(*Dest)(x,y).blue = gray(x,y);
+			(*Dest)(x,y).alpha = (*Source)(x,y).alpha;
+		}
+	}
+}
+
+//=========================================================================================================//
+//Simple function that generates the edge-detection image of Source and stores it in Dest.
+void CAIR_Edge( CAIR_Context * context, CML_color * Source, CAIR_convolution conv, CML_color * Dest )
+{
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	CML_gray gray( (*Source).Width(), (*Source).Height() );
+	Grayscale_Image( context, Source, &gray );
+
+	CML_int edge( (*Source).Width(), (*Source).Height() );
+	Edge_Detect( context, &gray, &edge, conv, NULL );
+
+	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
+
+	for( int x = 0; x < (*Source).Width(); x++ )
+	{
+		for( int y = 0; y < (*Source).Height(); y++ )
+		{
+			int value = edge(x,y);
+
+			if( value > 255 )
+			{
+				value = 255;
+			}
+
+			(*Dest)(x,y).red = (CML_byte)value;
+			(*Dest)(x,y).green = (CML_byte)value;
+			(*Dest)(x,y).blue = (CML_byte)value;
+			(*Dest)(x,y).alpha = (*Source)(x,y).alpha;
+		}
+	}
+}
+
+//=========================================================================================================//
+//Simple function that generates the vertical energy map of Source placing it into Dest.
+//All values are scaled down to their relative gray value. Weights are assumed all zero.
+void CAIR_V_Energy( CAIR_Context * context, CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest )
+{
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+	Resize_Threads( context, (*Source).Height() );
+
+	CML_gray gray( (*Source).Width(), (*Source).Height() );
+	Grayscale_Image( context, Source, &gray );
+
+	CML_int edge( (*Source).Width(), (*Source).Height() );
+	Cost_Planes Cost_Map;
+	Cost_Planes * Costs = Setup_Costs( &Cost_Map, ener, edge.Width(), edge.Height() );
+	Edge_Detect( context, &gray, &edge, conv, Costs );
+
+	CML_int energy( edge.Width(), edge.Height() );
+	CML_dir dir( edge.Width(), edge.Height() );
+	CML_int weights( edge.Width(), edge.Height() );
+	weights.Fill(0);
+
+	//calculate the energy map
+	Energy_Map( context, &edge, &weights, &energy, &dir, ener, Costs, NULL );
+
+	int max_energy = 0; //find the maximum energy value
+	for( int x = 0; x < energy.Width(); x++ )
+	{
+		for( int y = 0; y < energy.Height(); y++ )
+		{
+			if( energy(x,y) > max_energy )
+			{
+				max_energy = energy(x,y);
+			}
+		}
+	}
+	
+	(*Dest).D_Resize( (*Source).Width(), (*Source).Height() );
+
+	for( int x = 0; x < energy.Width(); x++ )
+	{
+		for( int y = 0; y < energy.Height(); y++ )
+		{
+			//scale the gray value down so we can get a realtive gray value for the energy level
+			int value = (int)(((double)energy(x,y) / max_energy) * 255);
+			if( value < 0 )
+			{
+				value = 0;
+			}
+
+			(*Dest)(x,y).red = (CML_byte)value;
+			(*Dest)(x,y).green = (CML_byte)value;
+			(*Dest)(x,y).blue = (CML_byte)value;
+			(*Dest)(x,y).alpha = (*Source)(x,y).alpha;
+		}
+	}
+} //end CAIR_V_Energy()
+
+//=========================================================================================================//
+//Simple function that generates the horizontal energy map of Source placing it into Dest.
+//All values are scaled down to their relative gray value. Weights are assumed all zero.
+void CAIR_H_Energy( CAIR_Context * context, CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest )
+{
+	CML_color Tsource( 1, 1 );
+	CML_color Tdest( 1, 1 );
+
+	Tsource.Transpose( Source );
+	CAIR_V_Energy( context, &Tsource, conv, ener, &Tdest );
+
+	(*Dest).Transpose( &Tdest );
+}
+
+//=========================================================================================================//
+//Experimental automatic object removal.
+//Any area with a negative weight will be removed. This function has three modes, determined by the choice paramater.
+//AUTO will have the function count the veritcal and horizontal rows/columns and remove in the direction that has the least.
+//VERTICAL will force the function to remove all negative weights in the veritcal direction; likewise for HORIZONTAL.
+//Because some conditions may cause the function not to remove all negative weights in one pass, max_attempts lets the function
+//go through the remoal process as many times as you're willing.
+bool CAIR_Removal( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, CAIR_direction choice, int max_attempts, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	int negative_x = 0;
+	int negative_y = 0;
+	CML_color Temp( 1, 1 );
+	Temp = (*Source);
+	(*D_Weights) = (*S_Weights);
+
+	for( int i = 0; i < max_attempts; i++ )
+	{
+		negative_x = 0;
+		negative_y = 0;
+
+		//count how many negative columns exist
+		for( int x = 0; x < (*D_Weights).Width(); x++ )
+		{
+			for( int y = 0; y < (*D_Weights).Height(); y++ )
+			{
+				if( (*D_Weights)(x,y) < 0 )
+				{
+					negative_x++;
+					break; //only breaks the inner loop
+				}
+			}
+		}
+
+		//count how many negative rows exist
+		for( int y = 0; y < (*D_Weights).Height(); y++ )
+		{
+			for( int x = 0; x < (*D_Weights).Width(); x++ )
+			{
+				if( (*D_Weights)(x,y) < 0 )
+				{
+					negative_y++;
+					break;
+				}
+			}
+		}
+
+		switch( choice )
+		{
+		case AUTO :
+			//remove in the direction that has the least to remove
+			if( negative_y < negative_x )
+			{
+				if( CAIR( context, &Temp, D_Weights, Temp.Width(), Temp.Height() - negative_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
+				{
+					return false;
+				}
+				Temp = (*Dest);
+			}
+			else
+			{
+				if( CAIR( context, &Temp, D_Weights, Temp.Width() - negative_x, Temp.Height(), add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
+				{
+					return false;
+				}
+				Temp = (*Dest);
+			}
+			break;
+
+		case HORIZONTAL :
+			if( CAIR( context, &Temp, D_Weights, Temp.Width(), Temp.Height() - negative_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
+			{
+				return false;
+			}
+			Temp = (*Dest);
+			break;
+
+		case VERTICAL :
+			if( CAIR( context, &Temp, D_Weights, Temp.Width() - negative_x, Temp.Height(), add_weight, conv, ener, D_Weights, Dest, CAIR_callback ) == false )
+			{
+				return false;
+			}
+			Temp = (*Dest);
+			break;
+		}
+	}
+
+	//now expand back out to the origional
+	return CAIR( context, &Temp, D_Weights, (*Source).Width(), (*Source).Height(), add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+} //end CAIR_Removal()
+
+//=========================================================================================================//
+//Precompute removals in the x direction. Map will hold the largest width the corisponding pixel is still visible.
+//This will calculate all removals down to 3 pixels in width.
+//Right now this only performs removals and only the x-direction. For the future enlarging is planned. Precomputing for both directions
+//doesn't work all that well and generates significant artifacts. This function is intended for "content-aware multi-size images" as mentioned
+//in the doctors' presentation. The next logical step would be to encode Map into an existing image format. Then, using a function like
+//CAIR_Map_Resize() the image can be resized on a client machine with very little overhead.
+void CAIR_Image_Map( CAIR_Context * context, CML_color * Source, CML_int * Weights, CAIR_convolution conv, CAIR_energy ener, CML_int * Map )
+{
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+	Resize_Threads( context, (*Source).Height() );
+
+	(*Map).D_Resize( (*Source).Width(), (*Source).Height() );
+	(*Map).Fill( 0 );
+
+	CML_color Temp( 1, 1 );
+	Temp = (*Source);
+	CML_int Temp_Weights( 1, 1 );
+	Temp_Weights = (*Weights); //don't change Weights since there is no change to the image
+
+	for( int i = Temp.Width(); i > 3; i-- ) //3 is the minimum safe amount with 3x3 convolution kernels without causing problems
+	{
+		//grayscale
+		CML_gray Grayscale( Temp.Width(), Temp.Height() );
+		Grayscale_Image( context, &Temp, &Grayscale );
+
+		//edge detect
+		CML_int Edge( Temp.Width(), Temp.Height() );
+		Cost_Planes Cost_Map;
+		Cost_Planes * Costs = Setup_Costs( &Cost_Map, ener, Temp.Width(), Temp.Height() );
+		Edge_Detect( context, &Grayscale, &Edge, conv, Costs );
+
+		//find the energy values, everything is recalculated each time so only a few energy rows are needed
+		int * Path = new int[(*Source).Height()];
+		CML_int Energy( Temp.Width(), ROLLING_ROWS );
+		CML_dir Dir( Temp.Width(), Temp.Height() );
+		Energy_Path( context, &Edge, &Temp_Weights, &Energy, &Dir, Path, ener, Costs, true );
+
+		//everything but the image and weights are rebuilt next time around, so nothing else needs repairs
+		Remove_Path( context, &Temp, Path, &Temp_Weights, &Edge, &Grayscale, NULL, NULL, NULL, NULL, conv );
+
+		//now set the corisponding map value with the resolution
+		for( int y = 0; y < Temp.Height(); y++ )
+		{
+			int index = 0;
+			int offset = Path[y];
+
+			while( (*Map)(index,y) != 0 ) index++; //find the pixel that is in location zero (first unused)
+			while( offset > 0 )
+			{
+				if( (*Map)(index,y) == 0 ) //find the correct x index
+				{
+					offset--;
+				}
+				index++;
+			}
+			while( (*Map)(index,y) != 0 ) index++; //if the current and subsequent pixels have been removed
+
+			(*Map)(index,y) = i; //this is now the smallest resolution this pixel will be visible
+		}
+
+		delete[] Path;
+	}
+} //end CAIR_Image_Map()
+
+//=========================================================================================================//
+//An "example" function on how to decode the Map to quickly resize an image. This is only for the width, since multi-directional
+//resizing produces significant artifacts. Do note this will produce different results than standard CAIR(), because this resize doesn't
+//average pixels back into the image as does CAIR(). This function could be multi-threaded much like Remove_Path() for even faster performance.
+void CAIR_Map_Resize( CML_color * Source, CML_int * Map, int goal_x, CML_color * Dest )
+{
+	(*Dest).D_Resize( goal_x, (*Source).Height() );
+
+	for( int y = 0; y < (*Source).Height(); y++ )
+	{
+		int input_x = 0; //map the Source's pixels to the Dests smaller size
+		for( int x = 0; x < goal_x; x++ )
+		{
+			while( (*Map)(input_x,y) > goal_x ) input_x++; //skip past pixels not in this resolution
+
+			(*Dest)(x,y) = (*Source)(input_x,y);
+			input_x++;
+		}
+	}
+}
+
+//=========================================================================================================//
+//==                                             C A I R  H D                                            ==//
+//=========================================================================================================//
+
+//=========================================================================================================//
+//CAIR_HD() keeps both the image and its transpose around. A path taken out of one is a path across the other, so
+//the other one has each of its columns shifted up from the path instead. The tasks below do that on strips of columns.
+
+//=========================================================================================================//
+//Blends the cross path back into the image and grayscale like Remove_Row() does, then shifts everything below it up a row.
+void Cross_Image_Task( CAIR_Context * context, int num )
+{
+	Thread_Params cross_area = context->thread_info[num];
+	int height = (*(cross_area.Source)).Height();
+
+	int top = height;
+	for( int x = cross_area.top_x; x < cross_area.bot_x; x++ )
+	{
+		int remove = (cross_area.Path)[x];
+		top = MIN( top, remove );
+
+		CML_RGBA * Pixel = &(*(cross_area.Source))(x,remove);
+		if( (remove - 1) > 0 )
+		{
+			CML_RGBA * Above = &(*(cross_area.Source))(x,remove-1);
+			if( (*(cross_area.D_Weights))(x,remove) >= 0 )
+			{
+				*Above = Average_Pixels( *Pixel, *Above );
+			}
+			(*(cross_area.Gray))(x,remove-1) = Grayscale_Pixel( Above );
+		}
+		if( (remove + 1) < height )
+		{
+			CML_RGBA * Below = &(*(cross_area.Source))(x,remove+1);
+			if( (*(cross_area.D_Weights))(x,remove) >= 0 )
+			{
+				*Below = Average_Pixels( *Pixel, *Below );
+			}
+			(*(cross_area.Gray))(x,remove+1) = Grayscale_Pixel( Below );
+		}
+	}
+
+	//a row at a time, so we aren't jumping through memory a column at a time
+	for( int y = top; (y < height - 1) && (Cancelled( context ) == false); y++ )
+	{
+		for( int x = cross_area.top_x; x < cross_area.bot_x; x++ )
+		{
+			if( y >= (cross_area.Path)[x] )
+			{
+				(*(cross_area.Source))(x,y) = (*(cross_area.Source))(x,y+1);
+				(*(cross_area.Gray))(x,y) = (*(cross_area.Gray))(x,y+1);
+				(*(cross_area.D_Weights))(x,y) = (*(cross_area.D_Weights))(x,y+1);
+			}
+		}
+	}
+}
+
+//=========================================================================================================//
+//Recalculates the edges in the band around the cross path, and shifts the ones below it up. The grayscale must be done.
+void Cross_Edge_Task( CAIR_Context * context, int num )
+{
+	Thread_Params cross_area = context->thread_info[num];
+	int width = (*(cross_area.Gray)).Width();
+	int height = (*(cross_area.Gray)).Height(); //the new height
+
+	int top = height;
+	for( int x = cross_area.top_x; x < cross_area.bot_x; x++ )
+	{
+		top = MIN( top, (cross_area.Band)[x*2] );
+	}
+
+	for( int y = top; (y < height) && (Cancelled( context ) == false); y++ )
+	{
+		for( int x = cross_area.top_x; x < cross_area.bot_x; x++ )
+		{
+			if( y > (cross_area.Band)[x*2+1] )
+			{
+				(*(cross_area.Edge))(x,y) = (*(cross_area.Edge))(x,y+1);
+			}
+			else if( y >= (cross_area.Band)[x*2] )
+			{
+				edge_safe safety = ( (x == 0) || (x == width - 1) || (y == 0) || (y == height - 1) ) ? SAFE : UNSAFE;
+				(*(cross_area.Edge))(x,y) = Convolve_Pixel( cross_area.Gray, x, y, safety, cross_area.conv );
+			}
+		}
+	}
+}
+
+//=========================================================================================================//
+//Recalculates the forward energy costs next to the changed edges, and shifts the ones below them up. The edges must be done.
+//The costs of a column use the edges on either side of it, so its band is widened to cover theirs.
+void Cross_Cost_Task( CAIR_Context * context, int num )
+{
+	Thread_Params cross_area = context->thread_info[num];
+	int width = (*(cross_area.Edge)).Width();
+	int height = (*(cross_area.Edge)).Height(); //the new height
+	int * Band = cross_area.Band;
+
+	//the boundary columns never use the forward costs
+	int left = MAX( cross_area.top_x, 1 );
+	int right = MIN( cross_area.bot_x, width - 1 );
+
+	int top = height;
+	for( int x = left; x < right; x++ )
+	{
+		top = MIN( top, MIN( Band[(x-1)*2], Band[(x+1)*2] ) );
+	}
+	top = MAX( top, 1 ); //neither does the top row
+
+	for( int y = top; (y < height) && (Cancelled( context ) == false); y++ )
+	{
+		for( int x = left; x < right; x++ )
+		{
+			int first = MIN( MIN( Band[(x-1)*2], Band[x*2] ), Band[(x+1)*2] );
+			int last = MAX( MAX( Band[(x-1)*2+1], Band[x*2+1] ), Band[(x+1)*2+1] ) + 1;
+
+			if( y > last )
+			{
+				(*(cross_area.Costs)).Left(x,y) = (*(cross_area.Costs)).Left(x,y+1);
+				(*(cross_area.Costs)).Up(x,y) = (*(cross_area.Costs)).Up(x,y+1);
+				(*(cross_area.Costs)).Right(x,y) = (*(cross_area.Costs)).Right(x,y+1);
+			}
+			else if( y >= first )
+			{
+				Forward_Cost_Row( cross_area.Edge, cross_area.Costs, y, x, x );
+			}
+		}
+	}
+}
+
+//=========================================================================================================//
+//Removes a path that runs across Source, one row per column, as given by Path. This is the same as transposing Source, removing
+//Path with Remove_Path(), and transposing it back, but only the edges and costs near the path are recalculated. The energy
+//map of Source is no good afterwards, since every column below the path has moved.
+void Remove_Cross( CAIR_Context * context, CML_color * Source, int * Path, CML_int * Weights, CML_int * Edge, CML_gray * Grayscale, Cost_Planes * Costs, CAIR_convolution conv )
+{
+	int width = (*Source).Width();
+	int height = (*Source).Height() - 1; //what we'll be when we're done
+	int thread_width = width / context->num_strips;
+
+	//the rows each edge column has to recalculate, around the path in it and on either side of it
+	//(for a 3x3 kernel: the blended pixel above the path, and the one that moves up into it)
+	int * Band = new int[width * 2];
+	for( int x = 0; x < width; x++ )
+	{
+		int least = Path[x];
+		int most = Path[x];
+		if( x > 0 )
+		{
+			least = MIN( least, Path[x-1] );
+			most = MAX( most, Path[x-1] );
+		}
+		if( x < width - 1 )
+		{
+			least = MIN( least, Path[x+1] );
+			most = MAX( most, Path[x+1] );
+		}
+		Band[x*2] = MAX( least - 2, 0 );
+		Band[x*2+1] = MIN( most + 1, height - 1 );
+	}
+
+	//setup parameters
+	for( int i = 0; i < context->num_strips; i++ )
+	{
+		context->thread_info[i].Source = Source;
+		context->thread_info[i].Path = Path;
+		context->thread_info[i].Band = Band;
+		context->thread_info[i].D_Weights = Weights;
+		context->thread_info[i].Edge = Edge;
+		context->thread_info[i].Gray = Grayscale;
+		context->thread_info[i].Costs = Costs;
+		context->thread_info[i].conv = conv;
+		context->thread_info[i].top_x = i * thread_width;
+		context->thread_info[i].bot_x = context->thread_info[i].top_x + thread_width;
+	}
+
+	//have the last strip pick up the slack
+	context->thread_info[context->num_strips-1].bot_x = width;
+
+	Run_Tasks( context, Cross_Image_Task, context->num_strips );
+	(*Source).Resize_Height( height );
+	(*Weights).Resize_Height( height );
+	(*Grayscale).Resize_Height( height );
+
+	//the edges need all of the grayscale done, and the costs all of the edges
+	Run_Tasks( context, Cross_Edge_Task, context->num_strips );
+	(*Edge).Resize_Height( height );
+	if( Costs != NULL )
+	{
+		Run_Tasks( context, Cross_Cost_Task, context->num_strips );
+		(*Costs).Left.Resize_Height( height );
+		(*Costs).Up.Resize_Height( height );
+		(*Costs).Right.Resize_Height( height );
+	}
+
+	delete[] Band;
+} //end Remove_Cross()
+
+//=========================================================================================================//
+//This works as CAIR, except here maximum quality is attempted. When removing in both directions some amount, CAIR_HD()
+//will determine which direction has the least amount of energy and then removes in that direction. This is only done
+//for removal, since enlarging will not benifit, although this function will perform addition just like CAIR().
+//Inputs are the same as CAIR().
+//Both directions are kept the whole way down, each with its own grayscale, edges, and energy. The direction a path is taken
+//from is updated by Remove_Path() like CAIR() does, and the other by Remove_Cross(). Only the other direction's energy map
+//has to be recalculated for the next path.
+bool CAIR_HD( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	//if no change, then just copy to the source to the destination
+	if( (goal_x == (*Source).Width()) && (goal_y == (*Source).Height() ) )
+	{
+		(*Dest) = (*Source);
+		(*D_Weights) = (*S_Weights);
+		return true;
+	}
+
+	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
+	int seams_done = 0;
+
+	CML_color Temp( 1, 1 );
+
+	//to start the loop
+	(*Dest) = (*Source);
+	(*D_Weights) = (*S_Weights);
+
+	if( ((*Dest).Width() > goal_x) && ((*Dest).Height() > goal_y) )
+	{
+		//the transposed side
+		CML_color TTemp( 1, 1 );
+		CML_int TWeights( 1, 1 );
+		TTemp.Transpose( Dest );
+		TWeights.Transpose( D_Weights );
+
+		//grayscale the normal and transposed
+		CML_gray Grayscale( (*Dest).Width(), (*Dest).Height() );
+		CML_gray TGrayscale( TTemp.Width(), TTemp.Height() );
+		Grayscale_Image( context, Dest, &Grayscale );
+		Grayscale_Image( context, &TTemp, &TGrayscale );
+
+		//edge detect
+		CML_int Edge( (*Dest).Width(), (*Dest).Height() );
+		CML_int TEdge( TTemp.Width(), TTemp.Height() );
+		Cost_Planes Cost_Map;
+		Cost_Planes TCost_Map;
+		Cost_Planes * Costs = Setup_Costs( &Cost_Map, ener, (*Dest).Width(), (*Dest).Height() );
+		Cost_Planes * TCosts = Setup_Costs( &TCost_Map, ener, TTemp.Width(), TTemp.Height() );
+		Edge_Detect( context, &Grayscale, &Edge, conv, Costs );
+		Edge_Detect( context, &TGrayscale, &TEdge, conv, TCosts );
+
+		int * Path = new int[(*Dest).Height()];
+		int * TPath = new int[TTemp.Height()];
+		CML_int Energy( (*Dest).Width(), (*Dest).Height() );
+		CML_int TEnergy( TTemp.Width(), TTemp.Height() );
+		CML_dir Dir( (*Dest).Width(), (*Dest).Height() );
+		CML_dir TDir( TTemp.Width(), TTemp.Height() );
+		bool x_ready = false; //whether the energy map is still good from the last path
+		bool y_ready = false;
+
+		//do this loop when we can remove in either direction
+		while( ((*Dest).Width() > goal_x) && ((*Dest).Height() > goal_y) )
+		{
+			//find the energy values, only doing the full map where the last path went across
+			int energy_x;
+			int energy_y;
+			if( x_ready == true )
+			{
+				energy_x = Least_Path( &Energy, &Dir, Path );
+			}
+			else
+			{
+				Energy.Resize_Height( (*Dest).Height() );
+				Dir.Resize_Height( (*Dest).Height() );
+				Resize_Threads( context, (*Dest).Height() );
+				energy_x = Energy_Path( context, &Edge, D_Weights, &Energy, &Dir, Path, ener, Costs, true );
+			}
+			if( y_ready == true )
+			{
+				energy_y = Least_Path( &TEnergy, &TDir, TPath );
+			}
+			else
+			{
+				TEnergy.Resize_Height( TTemp.Height() );
+				TDir.Resize_Height( TTemp.Height() );
+				Resize_Threads( context, TTemp.Height() );
+				energy_y = Energy_Path( context, &TEdge, &TWeights, &TEnergy, &TDir, TPath, ener, TCosts, true );
+			}
+
+			if( Cancelled( context ) == true )
+			{
+				delete[] Path;
+				delete[] TPath;
+				return false;
+			}
+
+			if( energy_y < energy_x )
+			{
+				Remove_Path( context, &TTemp, TPath, &TWeights, &TEdge, &TGrayscale, &TEnergy, &TDir, TCosts, NULL, conv );
+				Remove_Cross( context, Dest, TPath, D_Weights, &Edge, &Grayscale, Costs, conv );
+				x_ready = false;
+				y_ready = true;
+			}
+			else
+			{
+				Remove_Path( context, Dest, Path, D_Weights, &Edge, &Grayscale, &Energy, &Dir, Costs, NULL, conv );
+				Remove_Cross( context, &TTemp, Path, &TWeights, &TEdge, &TGrayscale, TCosts, conv );
+				x_ready = true;
+				y_ready = false;
+			}
+
+			if( (Cancelled( context ) == true) || ((CAIR_callback != NULL) && (CAIR_callback( (float)(seams_done)/total_seams ) == false)) )
+			{
+				delete[] Path;
+				delete[] TPath;
+				return false;
+			}
+			seams_done++;
+		}
+
+		delete[] Path;
+		delete[] TPath;
+	}
+
+	//one dimension is the now on the goal, so finish off the other direction
+	Temp = (*Dest);
+	return CAIR( context, &Temp, D_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+} //end CAIR_HD()
+
+//=========================================================================================================//
+//==                                          T R A N S P O R T                                          ==//
+//=========================================================================================================//
+
+//=========================================================================================================//
+//Shrinks Source and Weights down by scale in both directions into Dest and D_Weights, averaging each scale x scale block.
+void Shrink_Proxy( CML_color * Source, CML_int * Weights, int scale, CML_color * Dest, CML_int * D_Weights )
+{
+	int width = (*Source).Width() / scale;
+	int height = (*Source).Height() / scale;
+	int area = scale * scale;
+	(*Dest).D_Resize( width, height );
+	(*D_Weights).D_Resize( width, height );
+
+	for( int y = 0; y < height; y++ )
+	{
+		for( int x = 0; x < width; x++ )
+		{
+			int red = 0, green = 0, blue = 0, alpha = 0, weight = 0;
+			for( int j = y * scale; j < (y + 1) * scale; j++ )
+			{
+				for( int i = x * scale; i < (x + 1) * scale; i++ )
+				{
+					red += (*Source)(i,j).red;
+					green += (*Source)(i,j).green;
+					blue += (*Source)(i,j).blue;
+					alpha += (*Source)(i,j).alpha;
+					weight += (*Weights)(i,j);
+				}
+			}
+			(*Dest)(x,y).red = red / area;
+			(*Dest)(x,y).green = green / area;
+			(*Dest)(x,y).blue = blue / area;
+			(*Dest)(x,y).alpha = alpha / area;
+			(*D_Weights)(x,y) = weight / area;
+		}
+	}
+}
+
+//=========================================================================================================//
+//Takes the least energy path out of the proxy image, down it or across it, and returns the energy of that path.
+//Source and Weights are left alone, the result goes into Dest and D_Weights.
+int Proxy_Path( CAIR_Context * context, CML_color * Source, CML_int * Weights, bool across, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest, CML_int * D_Weights )
+{
+	if( across == true )
+	{
+		(*Dest).Transpose( Source );
+		(*D_Weights).Transpose( Weights );
+	}
+	else
+	{
+		(*Dest) = (*Source);
+		(*D_Weights) = (*Weights);
+	}
+
+	CML_gray Grayscale( (*Dest).Width(), (*Dest).Height() );
+	CML_int Edge( (*Dest).Width(), (*Dest).Height() );
+	CML_int Energy( (*Dest).Width(), ROLLING_ROWS ); //always recalculated, so only a few rows are needed
+	CML_dir Dir( (*Dest).Width(), (*Dest).Height() );
+	Cost_Planes Cost_Map;
+	Cost_Planes * Costs = Setup_Costs( &Cost_Map, ener, (*Dest).Width(), (*Dest).Height() );
+	int * Path = new int[(*Dest).Height()];
+
+	Grayscale_Image( context, Dest, &Grayscale );
+	Edge_Detect( context, &Grayscale, &Edge, conv, Costs );
+	Resize_Threads( context, (*Dest).Height() );
+	int energy = Energy_Path( context, &Edge, D_Weights, &Energy, &Dir, Path, ener, Costs, true );
+	Remove_Path( context, Dest, Path, D_Weights, &Edge, &Grayscale, NULL, NULL, NULL, NULL, conv );
+	delete[] Path;
+
+	if( across == true )
+	{
+		CML_color Temp( 1, 1 );
+		CML_int Temp_Weights( 1, 1 );
+		Temp = (*Dest);
+		Temp_Weights = (*D_Weights);
+		(*Dest).Transpose( &Temp );
+		(*D_Weights).Transpose( &Temp_Weights );
+	}
+
+	return energy;
+}
+
+//=========================================================================================================//
+//Plans the order of the paths for removing down to goal_x by goal_y with the transport map from the paper: the least total energy
+//to get to every (paths across, paths down) pair, built one row of pairs at a time from the images the best way there leaves.
+//That is far too much work at full size, so it's done on a copy shrunk down to about PLAN_PIXELS, and the order found there
+//is stretched back out to the real number of paths. Returns the order for CAIR_Transport() (delete[] it when done), or NULL if the
+//image shrinks down too small to plan on.
+CAIR_direction * Plan_Order( CAIR_Context * context, CML_color * Source, CML_int * Weights, int goal_x, int goal_y, CAIR_convolution conv, CAIR_energy ener )
+{
+	int removes_x = (*Source).Width() - goal_x;
+	int removes_y = (*Source).Height() - goal_y;
+	int scale = (int)ceil( sqrt( ((double)(*Source).Width() * (*Source).Height()) / PLAN_PIXELS ) );
+	scale = MAX( scale, PLAN_MIN_SCALE );
+	if( ((*Source).Width() / scale < 3) || ((*Source).Height() / scale < 3) )
+	{
+		return NULL;
+	}
+
+	CML_color Proxy( 1, 1 );
+	CML_int Proxy_Weights( 1, 1 );
+	Shrink_Proxy( Source, Weights, scale, &Proxy, &Proxy_Weights );
+
+	//how many paths each way on the proxy, at least one so the order has something to go on
+	int plan_x = MIN( MAX( (removes_x + scale / 2) / scale, 1 ), Proxy.Width() - 2 );
+	int plan_y = MIN( MAX( (removes_y + scale / 2) / scale, 1 ), Proxy.Height() - 2 );
+	int stride = plan_x + 1;
+
+	//the transport map, and whether each pair was best reached by a path across (true) or down (false)
+	long long * Transport = new long long[(plan_y + 1) * stride];
+	bool * Across = new bool[(plan_y + 1) * stride];
+
+	//the images for the current row of the map, each left by the best way to its pair
+	CML_color ** Images = new CML_color*[stride];
+	CML_int ** Image_Weights = new CML_int*[stride];
+	for( int j = 0; j < stride; j++ )
+	{
+		Images[j] = new CML_color( 1, 1 );
+		Image_Weights[j] = new CML_int( 1, 1 );
+	}
+	CML_color Down( 1, 1 );
+	CML_int Down_Weights( 1, 1 );
+
+	//the first row only has paths down
+	Startup_Threads( context, Proxy.Width(), Proxy.Height() );
+	(*Images[0]) = Proxy;
+	(*Image_Weights[0]) = Proxy_Weights;
+	Transport[0] = 0;
+	Across[0] = false;
+	for( int j = 1; j < stride; j++ )
+	{
+		Transport[j] = Transport[j-1] + Proxy_Path( context, Images[j-1], Image_Weights[j-1], false, conv, ener, Images[j], Image_Weights[j] );
+		Across[j] = false;
+	}
+
+	for( int i = 1; (i <= plan_y) && (Cancelled( context ) == false); i++ )
+	{
+		for( int j = 0; j < stride; j++ )
+		{
+			//Images[j] is still from the row above, and Images[j-1] is already from this one
+			int k = i * stride + j;
+			CML_color * Up = Images[j];
+			CML_int * Up_Weights = Image_Weights[j];
+			CML_color Across_Image( 1, 1 );
+			CML_int Across_Weights( 1, 1 );
+			long long across = Transport[k - stride] + Proxy_Path( context, Up, Up_Weights, true, conv, ener, &Across_Image, &Across_Weights );
+
+			if( j > 0 )
+			{
+				long long down = Transport[k - 1] + Proxy_Path( context, Images[j-1], Image_Weights[j-1], false, conv, ener, &Down, &Down_Weights );
+				if( down <= across )
+				{
+					Transport[k] = down;
+					Across[k] = false;
+					(*Up) = Down;
+					(*Up_Weights) = Down_Weights;
+					continue;
+				}
+			}
+			Transport[k] = across;
+			Across[k] = true;
+			(*Up) = Across_Image;
+			(*Up_Weights) = Across_Weights;
+		}
+	}
+
+	for( int j = 0; j < stride; j++ )
+	{
+		delete Images[j];
+		delete Image_Weights[j];
+	}
+	delete[] Images;
+	delete[] Image_Weights;
+
+	//the map isn't finished, so there's no way back through it
+	if( Cancelled( context ) == true )
+	{
+		delete[] Transport;
+		delete[] Across;
+		return NULL;
+	}
+
+	//walk back from the goal for the order on the proxy
+	bool * Steps = new bool[plan_x + plan_y];
+	for( int i = plan_y, j = plan_x, n = plan_x + plan_y - 1; n >= 0; n-- )
+	{
+		Steps[n] = Across[i * stride + j];
+		if( Steps[n] == true )
+		{
+			i--;
+		}
+		else
+		{
+			j--;
+		}
+	}
+
+	//stretch it out, each step on the proxy bringing the real counts up to the same fraction of the way
+	CAIR_direction * Order = new CAIR_direction[removes_x + removes_y];
+	int done_x = 0, done_y = 0, plan_done_x = 0, plan_done_y = 0, n = 0;
+	for( int s = 0; s < plan_x + plan_y; s++ )
+	{
+		if( Steps[s] == true )
+		{
+			plan_done_y++;
+			int want_y = (int)(((long long)removes_y * plan_done_y + plan_y / 2) / plan_y);
+			for( ; done_y < want_y; done_y++ )
+			{
+				Order[n++] = HORIZONTAL;
+			}
+		}
+		else
+		{
+			plan_done_x++;
+			int want_x = (int)(((long long)removes_x * plan_done_x + plan_x / 2) / plan_x);
+			for( ; done_x < want_x; done_x++ )
+			{
+				Order[n++] = VERTICAL;
+			}
+		}
+	}
+
+	delete[] Steps;
+	delete[] Transport;
+	delete[] Across;
+	return Order;
+} //end Plan_Order()
+
+//=========================================================================================================//
+//Removes in both directions in the order planned by Plan_Order(), so the quality is about that of CAIR_HD(). The order comes in
+//runs of paths the same way, and each run is taken out by CAIR_Remove() just like CAIR() does, so the image only has to be
+//transposed where the direction changes. Enlarging is done by CAIR().
+bool CAIR_Transport( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	//only worth planning when removing both ways
+	if( (goal_x >= (*Source).Width()) || (goal_y >= (*Source).Height()) )
+	{
+		return CAIR( context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+	}
+
+	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
+	CAIR_direction * Order = Plan_Order( context, Source, S_Weights, goal_x, goal_y, conv, ener );
+	if( Cancelled( context ) == true )
+	{
+		delete[] Order;
+		return false;
+	}
+	if( Order == NULL )
+	{
+		//too small to plan on, so just pick as we go
+		return CAIR_HD( context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+	}
+
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	CML_color Temp( 1, 1 );
+	CML_color TTemp( 1, 1 );
+	CML_int TWeights( 1, 1 );
+	Temp = (*Source);
+	(*D_Weights) = (*S_Weights);
+	bool across = false; //whether Temp and D_Weights are transposed right now
+
+	for( int n = 0; n < total_seams; )
+	{
+		int run = 1;
+		while( (n + run < total_seams) && (Order[n + run] == Order[n]) )
+		{
+			run++;
+		}
+
+		if( (Order[n] == HORIZONTAL) != across )
+		{
+			TTemp.Transpose( &Temp );
+			TWeights.Transpose( D_Weights );
+			Temp = TTemp;
+			(*D_Weights) = TWeights;
+			across = !across;
+		}
+
+		if( CAIR_Remove( context, &Temp, D_Weights, Temp.Width() - run, conv, ener, Dest, CAIR_callback, total_seams, n, NULL, NULL ) == false )
+		{
+			delete[] Order;
+			return false;
+		}
+		Temp = (*Dest);
+		n += run;
+	}
+	delete[] Order;
+
+	//store back the transposed info
+	if( across == true )
+	{
+		(*Dest).Transpose( &Temp );
+		TWeights = (*D_Weights);
+		(*D_Weights).Transpose( &TWeights );
+	}
+	return true;
+} //end CAIR_Transport()
+
+//=========================================================================================================//
+//Makes count narrower versions of Source in one run, with the widths in goal_x (in any order). The paths are removed down to the
+//smallest width just like CAIR(), and the image and weights are copied out to Dests[i] and D_Weights[i] as the run passes goal_x[i].
+//Widths at or over the width of Source get a copy of it. Once a rung is stored, CAIR_rung (if not NULL) is called with its index,
+//and the run stops if it returns false. Without batching, each rung matches a CAIR() to its width; with batching, the batches are
+//cut short at each rung, so the results can differ a little.
+bool CAIR_Ladder( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int * goal_x, int count, CAIR_convolution conv, CAIR_energy ener, CML_int ** D_Weights, CML_color ** Dests, bool (*CAIR_callback)(float), bool (*CAIR_rung)(int) )
+{
+	if( count < 1 )
+	{
+		return true;
+	}
+	for( int i = 0; i < count; i++ )
+	{
+		if( goal_x[i] < 1 )
+		{
+			return false;
+		}
+	}
+
+	//put the rungs in order, widest first
+	Ladder_Rungs Rungs;
+	Rungs.count = count;
+	Rungs.next = 0;
+	Rungs.order = new int[count];
+	Rungs.widths = goal_x;
+	Rungs.D_Weights = D_Weights;
+	Rungs.Dests = Dests;
+	Rungs.CAIR_rung = CAIR_rung;
+	for( int i = 0; i < count; i++ )
+	{
+		int j = i;
+		for( ; (j > 0) && (goal_x[Rungs.order[j-1]] < goal_x[i]); j-- )
+		{
+			Rungs.order[j] = Rungs.order[j-1];
+		}
+		Rungs.order[j] = i;
+	}
+
+	int least = goal_x[Rungs.order[count-1]];
+	bool result;
+	if( least >= (*Source).Width() )
+	{
+		//nothing to remove
+		result = Take_Rungs( &Rungs, Source, S_Weights );
+	}
+	else
+	{
+		Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+		CML_color Temp( 1, 1 );
+		CML_int Weights( 1, 1 );
+		Weights = (*S_Weights);
+		result = CAIR_Remove( context, Source, &Weights, least, conv, ener, &Temp, CAIR_callback, (*Source).Width() - least, 0, NULL, &Rungs );
+	}
+
+	delete[] Rungs.order;
+	return result;
+} //end CAIR_Ladder()
+
+//=========================================================================================================//
+//==                                              R E P L A Y                                            ==//
+//=========================================================================================================//
+
+//=========================================================================================================//
+//Adds Path to the end of the list. Path has length entries, stride apart.
+void Record_Path( CAIR_Seam_List * Seams, int * Path, int length, int stride )
+{
+	if( (*Seams).count >= (*Seams).Steps.Height() )
+	{
+		return;
+	}
+
+	signed char * Row = &(*Seams).Steps(0,(*Seams).count);
+	(*Seams).Starts(0,(*Seams).count) = Path[0];
+	Row[0] = 0;
+	for( int y = 1; y < length; y++ )
+	{
+		Row[y] = (signed char)( Path[y * stride] - Path[(y - 1) * stride] );
+	}
+	(*Seams).count++;
+}
+
+//=========================================================================================================//
+//Copies the next path in the list into Path, with as many entries as the list's image is high at the moment.
+void Next_Seam( Seam_Replay * replay, int * Path )
+{
+	signed char * Row = &(*(replay->Seams)).Steps(0,replay->next);
+	Path[0] = (*(replay->Seams)).Starts(0,replay->next);
+	for( int y = 1; y < replay->height; y++ )
+	{
+		Path[y] = Path[y - 1] + Row[y];
+	}
+	replay->next++;
+}
+
+//=========================================================================================================//
+//Sets up the next step of CAIR_Replay(), with everything turned the way that step sees the image.
+void Replay_Step( Seam_Replay * replay, int scale_x, int scale_y, int width, int height )
+{
+	replay->scale_x = scale_x;
+	replay->scale_y = scale_y;
+	replay->width = width;
+	replay->height = height;
+}
+
+//=========================================================================================================//
+//Runs CAIR() while keeping every path it removes and adds in Seams, in the order it used them.
+//Enlarging is always done one path at a time (the WEIGHTED add mode), so each added path can be kept.
+bool CAIR_Seams( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, CAIR_Seam_List * Seams, bool (*CAIR_callback)(float) )
+{
+	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
+	int longest = MAX( MAX( (*Source).Width(), goal_x ), MAX( (*Source).Height(), goal_y ) );
+
+	(*Seams).width = (*Source).Width();
+	(*Seams).height = (*Source).Height();
+	(*Seams).goal_x = goal_x;
+	(*Seams).goal_y = goal_y;
+	(*Seams).count = 0;
+	(*Seams).Starts.D_Resize( 1, MAX( total_seams, 1 ) );
+	(*Seams).Steps.D_Resize( longest, MAX( total_seams, 1 ) );
+
+	context->record = Seams;
+	bool result = CAIR( context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+	context->record = NULL;
+
+	return result;
+} //end CAIR_Seams()
+
+//=========================================================================================================//
+//Does to Source what CAIR_Seams() did to the image Seams was made from. Source must be at least as large as that image, and is
+//split into blocks of the size it is over that image (the last blocks take the leftover pixels). Each path from the list then
+//stands for that many paths here, which are found in a band of a block to either side of it, like CAIR_Pyramid() does.
+//Returns false if the list doesn't fit Source, or we were cancelled.
+bool CAIR_Replay( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, CAIR_Seam_List * Seams, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	int list_x = (*Seams).width;
+	int list_y = (*Seams).height;
+	if( (list_x < 1) || (list_y < 1) || ((*Source).Width() < list_x) || ((*Source).Height() < list_y) ||
+		((*Seams).count != abs(list_x-(*Seams).goal_x) + abs(list_y-(*Seams).goal_y)) )
+	{
+		return false;
+	}
+
+	int scale_x = (*Source).Width() / list_x;
+	int scale_y = (*Source).Height() / list_y;
+	int goal_x = (*Source).Width() + ((*Seams).goal_x - list_x) * scale_x;
+	int goal_y = (*Source).Height() + ((*Seams).goal_y - list_y) * scale_y;
+
+	//if no change, then just copy to the source to the destination
+	if( (goal_x == (*Source).Width()) && (goal_y == (*Source).Height()) )
+	{
+		(*Dest) = (*Source);
+		(*D_Weights) = (*S_Weights);
+		return true;
+	}
+
+	int total_seams = abs((*Source).Width()-goal_x) + abs((*Source).Height()-goal_y);
+	int seams_done = 0;
+
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	Seam_Replay replay;
+	replay.Seams = Seams;
+	replay.next = 0;
+	context->replay = &replay;
+
+	CML_color Temp( 1, 1 );
+	Temp = (*Source);
+	(*D_Weights) = (*S_Weights);
+	bool result = true;
+
+	//the same steps as CAIR(), which is the order the list is in
+	if( (result == true) && (goal_x < (*Source).Width()) )
+	{
+		Replay_Step( &replay, scale_x, scale_y, list_x, list_y );
+		result = CAIR_Remove( context, Source, D_Weights, goal_x, conv, ener, Dest, CAIR_callback, total_seams, seams_done, NULL, NULL );
+		Temp = (*Dest);
+		seams_done += abs((*Source).Width()-goal_x);
+	}
+
+	if( (result == true) && (goal_y < (*Source).Height()) )
+	{
+		CML_color TSource( 1, 1 );
+		CML_color TDest( 1, 1 );
+		CML_int TWeights( 1, 1 );
+		TSource.Transpose( &Temp );
+		TWeights.Transpose( D_Weights );
+
+		Replay_Step( &replay, scale_y, scale_x, list_y, MIN( list_x, (*Seams).goal_x ) );
+		result = CAIR_Remove( context, &TSource, &TWeights, goal_y, conv, ener, &TDest, CAIR_callback, total_seams, seams_done, NULL, NULL );
+
+		(*Dest).Transpose( &TDest );
+		(*D_Weights).Transpose( &TWeights );
+		Temp = (*Dest);
+		seams_done += abs((*Source).Height()-goal_y);
+	}
+
+	if( (result == true) && (goal_x > (*Source).Width()) )
+	{
+		Replay_Step( &replay, scale_x, scale_y, list_x, MIN( list_y, (*Seams).goal_y ) );
+		result = CAIR_Add( context, &Temp, D_Weights, goal_x, add_weight, conv, ener, Dest, CAIR_callback, total_seams, seams_done );
+		Temp = (*Dest);
+		seams_done += abs((*Source).Width()-goal_x);
+	}
+
+	if( (result == true) && (goal_y > (*Source).Height()) )
+	{
+		CML_color TSource( 1, 1 );
+		CML_color TDest( 1, 1 );
+		CML_int TWeights( 1, 1 );
+		TSource.Transpose( &Temp );
+		TWeights.Transpose( D_Weights );
+
+		Replay_Step( &replay, scale_y, scale_x, list_y, (*Seams).goal_x );
+		result = CAIR_Add( context, &TSource, &TWeights, goal_y, add_weight, conv, ener, &TDest, CAIR_callback, total_seams, seams_done );
+
+		(*Dest).Transpose( &TDest );
+		(*D_Weights).Transpose( &TWeights );
+	}
+
+	context->replay = NULL;
+	return result;
+} //end CAIR_Replay()
+
+//=========================================================================================================//
+//Does the paths of one step to row y of the map. Each path's entry is where it was in the row by the time it got there, so we
+//keep how many copies of each old pixel are left in a Fenwick tree. Walking down it finds the old pixel under an entry without
+//shifting the row over for every path, and the row is only written out once at the end.
+void Apply_Row( Plane_Apply * apply, int * Counts, int * Tree, int top, int y )
+{
+	int width = (*(apply->From)).Width();
+	int new_width = (*(apply->To)).Width();
+	int * Entries = &(*(apply->Paths))(0,y);
+
+	//every old pixel starts out there once
+	for( int i = 0; i < width; i++ )
+	{
+		Counts[i] = 1;
+		Tree[i+1] = 0;
+	}
+	for( int i = 1; i <= width; i++ )
+	{
+		Tree[i]++;
+		int parent = i + ( i & -i );
+		if( parent <= width )
+		{
+			Tree[parent] += Tree[i];
+		}
+	}
+
+	int current = width;
+	for( int p = 0; p < apply->count; p++ )
+	{
+		//find the old pixel that is at this entry now
+		int left = MIN( MAX( Entries[p], 0 ), current - 1 ) + 1;
+		int old = 0;
+		for( int step = top; step > 0; step >>= 1 )
+		{
+			if( (old + step <= width) && (Tree[old + step] < left) )
+			{
+				old += step;
+				left -= Tree[old];
+			}
+		}
+
+		Counts[old] += apply->change;
+		for( int i = old + 1; i <= width; i += i & -i )
+		{
+			Tree[i] += apply->change;
+		}
+		current += apply->change;
+	}
+
+	int * From = &(*(apply->From))(0,y);
+	int * To = &(*(apply->To))(0,y);
+	int x = 0;
+	for( int i = 0; i < width; i++ )
+	{
+		for( int c = 0; (c < Counts[i]) && (x < new_width); c++ )
+		{
+			To[x] = From[i];
+			x++;
+		}
+	}
+}
+
+//=========================================================================================================//
+//One step of CAIR_Apply(), for the rows from top_y to bot_y.
+void Apply_Task( CAIR_Context * context, int num )
+{
+	Thread_Params apply_area = context->thread_info[num];
+	int width = (*(apply_area.Apply->From)).Width();
+	int * Counts = new int[width];
+	int * Tree = new int[width+1];
+
+	//the largest power of two in the tree, where each walk down starts
+	int top = 1;
+	while( (top << 1) <= width )
+	{
+		top <<= 1;
+	}
+
+	for( int y = apply_area.top_y; y < apply_area.bot_y; y++ )
+	{
+		Apply_Row( apply_area.Apply, Counts, Tree, top, y );
+	}
+
+	delete[] Counts;
+	delete[] Tree;
+}
+
+//=========================================================================================================//
+//Splits the rows of the map up between the tasks, and runs them.
+void Apply_Tasks( CAIR_Context * context, Plane_Apply * apply, void (*task)( CAIR_Context * context, int num ) )
+{
+	int height = (*(apply->To)).Height();
+	int strips = MIN( context->num_strips, height );
+	int thread_height = height / strips;
+
+	//setup parameters
+	for( int i = 0; i < strips; i++ )
+	{
+		context->thread_info[i].Apply = apply;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
+	}
+
+	//have the last strip pick up the slack
+	context->thread_info[strips-1].bot_y = height;
+
+	Run_Tasks( context, task, strips );
+}
+
+//=========================================================================================================//
+//Does the next count paths from the list to the map, all at once. change is -1 to remove them and 1 to add them. The map and
+//spare are swapped, so Map is always the current one.
+void Apply_Step( CAIR_Context * context, Seam_Replay * replay, CML_int ** Map, CML_int ** Spare, int count, int change )
+{
+	if( count == 0 )
+	{
+		return;
+	}
+
+	//unpack the paths, so each row has its entries together
+	int height = (**Map).Height();
+	CML_int Paths( count, height );
+	int * Path = new int[height];
+	replay->height = height;
+	for( int p = 0; p < count; p++ )
+	{
+		Next_Seam( replay, Path );
+		for( int y = 0; y < height; y++ )
+		{
+			Paths(p,y) = Path[y];
+		}
+	}
+	delete[] Path;
+
+	(**Spare).D_Resize( (**Map).Width() + change * count, height );
+
+	Plane_Apply apply;
+	apply.From = *Map;
+	apply.To = *Spare;
+	apply.Paths = &Paths;
+	apply.count = count;
+	apply.change = change;
+	Apply_Tasks( context, &apply, Apply_Task );
+
+	CML_int * Temp = *Map;
+	*Map = *Spare;
+	*Spare = Temp;
+}
+
+//=========================================================================================================//
+//Same as Apply_Step(), for the paths across the image.
+void Apply_Cross_Step( CAIR_Context * context, Seam_Replay * replay, CML_int ** Map, CML_int ** Spare, int count, int change )
+{
+	if( count == 0 )
+	{
+		return;
+	}
+
+	(**Spare).Transpose( *Map );
+	CML_int * Temp = *Map;
+	*Map = *Spare;
+	*Spare = Temp;
+
+	Apply_Step( context, replay, Map, Spare, count, change );
+
+	(**Spare).Transpose( *Map );
+	Temp = *Map;
+	*Map = *Spare;
+	*Spare = Temp;
+}
+
+//=========================================================================================================//
+//Copies size bytes at a time from Old into the row, as the map says. Called with a constant size, so each one is a plain copy.
+inline void Gather_Row( unsigned char * Row, unsigned char * Old, int * Map, int width, int size )
+{
+	for( int x = 0; x < width; x++ )
+	{
+		memcpy( Row + x * size, Old + (size_t)Map[x] * size, size );
+	}
+}
+
+//=========================================================================================================//
+//Fills the rows from top_y to bot_y of every plane from their old elements.
+void Gather_Task( CAIR_Context * context, int num )
+{
+	Thread_Params gather_area = context->thread_info[num];
+	Plane_Apply * apply = gather_area.Apply;
+	int width = (*(apply->To)).Width();
+
+	for( int y = gather_area.top_y; y < gather_area.bot_y; y++ )
+	{
+		int * Map = &(*(apply->To))(0,y);
+		for( int i = 0; i < apply->planes; i++ )
+		{
+			unsigned char * Row = apply->Planes[i].Row( apply->Planes[i].matrix, y );
+			switch( apply->Planes[i].size )
+			{
+			case 1 :
+				Gather_Row( Row, apply->Old[i], Map, width, 1 );
+				break;
+			case 2 :
+				Gather_Row( Row, apply->Old[i], Map, width, 2 );
+				break;
+			case 4 :
+				Gather_Row( Row, apply->Old[i], Map, width, 4 );
+				break;
+			case 8 :
+				Gather_Row( Row, apply->Old[i], Map, width, 8 );
+				break;
+			default :
+				Gather_Row( Row, apply->Old[i], Map, width, apply->Planes[i].size );
+				break;
+			}
+		}
+	}
+}
+
+//=========================================================================================================//
+//Carves the planes along the list's paths. The paths are done to a map of where each pixel came from, in the same steps as
+//CAIR(), so they only have to be worked through once no matter how many planes there are. Then every plane is filled from
+//the map in one pass. Returns false if the list or a plane doesn't fit.
+bool CAIR_Apply( CAIR_Context * context, CAIR_Seam_List * Seams, CAIR_Plane * Planes, int count )
+{
+	int list_x = (*Seams).width;
+	int list_y = (*Seams).height;
+	int goal_x = (*Seams).goal_x;
+	int goal_y = (*Seams).goal_y;
+	if( (list_x < 1) || (list_y < 1) || (goal_x < 1) || (goal_y < 1) || ((*Seams).count != abs(list_x-goal_x) + abs(list_y-goal_y)) )
+	{
+		return false;
+	}
+	for( int i = 0; i < count; i++ )
+	{
+		if( (Planes[i].width != list_x) || (Planes[i].height != list_y) )
+		{
+			return false;
+		}
+	}
+
+	Startup_Threads( context, list_x, list_y );
+
+	//start with every pixel coming from itself
+	CML_int Map_A( list_x, list_y );
+	CML_int Map_B( 1, 1 );
+	for( int y = 0; y < list_y; y++ )
+	{
+		for( int x = 0; x < list_x; x++ )
+		{
+			Map_A(x,y) = y * list_x + x;
+		}
+	}
+	CML_int * Map = &Map_A;
+	CML_int * Spare = &Map_B;
+
+	Seam_Replay replay;
+	replay.Seams = Seams;
+	replay.next = 0;
+
+	//the same steps as CAIR(), which is the order the list is in
+	Apply_Step( context, &replay, &Map, &Spare, MAX( list_x - goal_x, 0 ), -1 );
+	Apply_Cross_Step( context, &replay, &Map, &Spare, MAX( list_y - goal_y, 0 ), -1 );
+	Apply_Step( context, &replay, &Map, &Spare, MAX( goal_x - list_x, 0 ), 1 );
+	Apply_Cross_Step( context, &replay, &Map, &Spare, MAX( goal_y - list_y, 0 ), 1 );
+
+	//keep what the planes had, then fill them in at the new size
+	unsigned char ** Old = new unsigned char *[MAX( count, 1 )];
+	for( int i = 0; i < count; i++ )
+	{
+		int row_bytes = list_x * Planes[i].size;
+		Old[i] = new unsigned char[(size_t)row_bytes * list_y];
+		for( int y = 0; y < list_y; y++ )
+		{
+			memcpy( Old[i] + (size_t)y * row_bytes, Planes[i].Row( Planes[i].matrix, y ), row_bytes );
+		}
+
+		Planes[i].Resize( Planes[i].matrix, goal_x, goal_y );
+		Planes[i].width = goal_x;
+		Planes[i].height = goal_y;
+	}
+
+	Plane_Apply apply;
+	apply.From = Map;
+	apply.To = Map;
+	apply.Planes = Planes;
+	apply.Old = Old;
+	apply.planes = count;
+	Apply_Tasks( context, &apply, Gather_Task );
+
+	for( int i = 0; i < count; i++ )
+	{
+		delete[] Old[i];
+	}
+	delete[] Old;
+
+	return true;
+} //end CAIR_Apply()
+
+//=========================================================================================================//
+//==                                              H Y B R I D                                            ==//
+//=========================================================================================================//
+
+//=========================================================================================================//
+//Works out the old pixels that make up each of the new ones when going from old to new pixels across. Shrinking averages
+//the old pixels each new one covers (weighted by how much it covers), and enlarging blends the two nearest old pixels.
+//The weights of each new pixel add up to exactly 1 << RESAMPLE_BITS.
+void Resample_Taps( Resample_Pass * pass, int old_size, int new_size )
+{
+	double ratio = (double)old_size / new_size;
+	pass->most = ( new_size < old_size ) ? (int)ceil( ratio ) + 1 : 2;
+	pass->first = new int[new_size];
+	pass->count = new int[new_size];
+	pass->weights = new int[new_size * pass->most];
+
+	for( int i = 0; i < new_size; i++ )
+	{
+		int * Weights = &(pass->weights[i * pass->most]);
+		double weights[2];
+		double * Taps = weights;
+		double * Area = NULL;
+
+		if( new_size < old_size )
+		{
+			//the stretch of old pixels this one covers
+			double left = i * ratio;
+			double right = MIN( (i + 1) * ratio, (double)old_size );
+			pass->first[i] = (int)floor( left );
+			pass->count[i] = MIN( (int)ceil( right ) - pass->first[i], pass->most );
+			Area = new double[pass->count[i]];
+			for( int t = 0; t < pass->count[i]; t++ )
+			{
+				double start = MAX( left, (double)(pass->first[i] + t) );
+				double end = MIN( right, (double)(pass->first[i] + t + 1) );
+				Area[t] = MAX( end - start, 0.0 ) / ratio;
+			}
+			Taps = Area;
+		}
+		else
+		{
+			//the two old pixels around this one's center
+			double center = MAX( (i + 0.5) * ratio - 0.5, 0.0 );
+			pass->first[i] = MIN( (int)floor( center ), old_size - 1 );
+			pass->count[i] = ( pass->first[i] < old_size - 1 ) ? 2 : 1;
+			weights[0] = 1.0 - ( center - pass->first[i] );
+			weights[1] = center - pass->first[i];
+		}
+
+		//round to fixed point, with what's left over going to the heaviest
+		int total = 0;
+		int heaviest = 0;
+		for( int t = 0; t < pass->count[i]; t++ )
+		{
+			Weights[t] = (int)( Taps[t] * (1 << RESAMPLE_BITS) + 0.5 );
+			total += Weights[t];
+			if( Weights[t] > Weights[heaviest] )
+			{
+				heaviest = t;
+			}
+		}
+		Weights[heaviest] += (1 << RESAMPLE_BITS) - total;
+
+		delete[] Area;
+	}
+}
+
+//=========================================================================================================//
+//Resamples the rows from top_y to bot_y of From across, into To.
+void Resample_Across_Task( CAIR_Context * context, int num )
+{
+	Thread_Params resample_area = context->thread_info[num];
+	Resample_Pass * pass = resample_area.Resample;
+	int width = (*(pass->To)).Width();
+
+	for( int y = resample_area.top_y; y < resample_area.bot_y; y++ )
+	{
+		CML_RGBA * Old = &(*(pass->From))(0,y);
+		CML_RGBA * New = &(*(pass->To))(0,y);
+		for( int x = 0; x < width; x++ )
+		{
+			CML_RGBA * Taps = &Old[pass->first[x]];
+			int * Weights = &(pass->weights[x * pass->most]);
+			int red = 1 << (RESAMPLE_BITS - 1), green = red, blue = red, alpha = red;
+			for( int t = 0; t < pass->count[x]; t++ )
+			{
+				red += Taps[t].red * Weights[t];
+				green += Taps[t].green * Weights[t];
+				blue += Taps[t].blue * Weights[t];
+				alpha += Taps[t].alpha * Weights[t];
+			}
+			New[x].red = (CML_byte)( red >> RESAMPLE_BITS );
+			New[x].green = (CML_byte)( green >> RESAMPLE_BITS );
+			New[x].blue = (CML_byte)( blue >> RESAMPLE_BITS );
+			New[x].alpha = (CML_byte)( alpha >> RESAMPLE_BITS );
+		}
+	}
+}
+
+//=========================================================================================================//
+//Resamples the rows from top_y to bot_y of To down from the rows of From. Each old row is added into the whole new row at once,
+//so the inner loop runs straight along the row with the same weight, which the compiler can vectorize.
+void Resample_Down_Task( CAIR_Context * context, int num )
+{
+	Thread_Params resample_area = context->thread_info[num];
+	Resample_Pass * pass = resample_area.Resample;
+	int channels = (*(pass->To)).Width() * 4;
+	int * Sum = new int[channels];
+
+	for( int y = resample_area.top_y; y < resample_area.bot_y; y++ )
+	{
+		for( int c = 0; c < channels; c++ )
+		{
+			Sum[c] = 1 << (RESAMPLE_BITS - 1);
+		}
+
+		int * Weights = &(pass->weights[y * pass->most]);
+		for( int t = 0; t < pass->count[y]; t++ )
+		{
+			CML_byte * Old = (CML_byte *)&(*(pass->From))(0,pass->first[y]+t);
+			int weight = Weights[t];
+			for( int c = 0; c < channels; c++ )
+			{
+				Sum[c] += Old[c] * weight;
+			}
+		}
+
+		CML_byte * New = (CML_byte *)&(*(pass->To))(0,y);
+		for( int c = 0; c < channels; c++ )
+		{
+			New[c] = (CML_byte)( Sum[c] >> RESAMPLE_BITS );
+		}
+	}
+
+	delete[] Sum;
+}
+
+//=========================================================================================================//
+//Runs one pass of Resample_Image() over the rows of To.
+void Resample_Tasks( CAIR_Context * context, Resample_Pass * pass, void (*task)( CAIR_Context * context, int num ) )
+{
+	int height = (*(pass->To)).Height();
+	int strips = MIN( context->num_strips, height );
+	int thread_height = height / strips;
+
+	//setup parameters
+	for( int i = 0; i < strips; i++ )
+	{
+		context->thread_info[i].Resample = pass;
+		context->thread_info[i].top_y = i * thread_height;
+		context->thread_info[i].bot_y = context->thread_info[i].top_y + thread_height;
+	}
+
+	//have the last strip pick up the slack
+	context->thread_info[strips-1].bot_y = height;
+
+	Run_Tasks( context, task, strips );
+
+	delete[] pass->first;
+	delete[] pass->count;
+	delete[] pass->weights;
+}
+
+//=========================================================================================================//
+//Scales Source to width x height into Dest, across and then down, with fixed point weights (see Resample_Taps()).
+//Weights are scaled too, by taking the nearest one, since they mark areas rather than blend.
+void Resample_Image( CAIR_Context * context, CML_color * Source, CML_int * Weights, int width, int height, CML_color * Dest )
+{
+	CML_color Across( width, (*Source).Height() );
+	Resample_Pass pass;
+
+	pass.From = Source;
+	pass.To = &Across;
+	Resample_Taps( &pass, (*Source).Width(), width );
+	Resample_Tasks( context, &pass, Resample_Across_Task );
+
+	(*Dest).D_Resize( width, height );
+	pass.From = &Across;
+	pass.To = Dest;
+	Resample_Taps( &pass, (*Source).Height(), height );
+	Resample_Tasks( context, &pass, Resample_Down_Task );
+
+	CML_int Old_Weights( 1, 1 );
+	Old_Weights = (*Weights);
+	(*Weights).D_Resize( width, height );
+	for( int y = 0; y < height; y++ )
+	{
+		int old_y = (int)( ( (long long)y * Old_Weights.Height() ) / height );
+		for( int x = 0; x < width; x++ )
+		{
+			(*Weights)(x,y) = Old_Weights( (int)( ( (long long)x * Old_Weights.Width() ) / width ), old_y );
+		}
+	}
+}
+
+//=========================================================================================================//
+//Carves the image down towards goal_x by goal_y like CAIR(), but only within the budget: at most seam_budget paths and
+//time_budget milliseconds (-1 for no limit), and only while the paths cost less than payoff percent of an average path on the
+//first energy map (0 for no limit, see Average_Path()). Then the image is resampled the rest of the way (see Resample_Image()).
+//Enlarging is all resampled.
+bool CAIR_Hybrid( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int seam_budget, int time_budget, int payoff, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	if( (goal_x < 1) || (goal_y < 1) )
+	{
+		return false;
+	}
+
+	Carve_Budget budget;
+	budget.seams = seam_budget;
+	budget.timed = ( time_budget >= 0 );
+	budget.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( MAX( time_budget, 0 ) );
+	budget.payoff = MAX( payoff, 0 );
+	budget.stopped = false;
+
+	int total_seams = MAX( (*Source).Width() - goal_x, 0 ) + MAX( (*Source).Height() - goal_y, 0 );
+	int seams_done = 0;
+
+	Startup_Threads( context, (*Source).Width(), (*Source).Height() );
+
+	CML_color Temp( 1, 1 );
+	Temp = (*Source);
+	(*D_Weights) = (*S_Weights);
+	bool result = true;
+	context->budget = &budget;
+
+	if( (goal_x < (*Source).Width()) && (seam_budget != 0) && (time_budget != 0) )
+	{
+		result = CAIR_Remove( context, Source, D_Weights, goal_x, conv, ener, &Temp, CAIR_callback, total_seams, seams_done, NULL, NULL );
+		seams_done += (*Source).Width() - Temp.Width();
+	}
+
+	//each direction gets its own go at the payoff, but the paths and time are shared
+	budget.stopped = false;
+	if( (result == true) && (goal_y < Temp.Height()) && (budget.seams != 0) )
+	{
+		CML_color TSource( 1, 1 );
+		CML_color TDest( 1, 1 );
+		CML_int TWeights( 1, 1 );
+		TSource.Transpose( &Temp );
+		TWeights.Transpose( D_Weights );
+
+		result = CAIR_Remove( context, &TSource, &TWeights, goal_y, conv, ener, &TDest, CAIR_callback, total_seams, seams_done, NULL, NULL );
+
+		Temp.Transpose( &TDest );
+		(*D_Weights).Transpose( &TWeights );
+	}
+	context->budget = NULL;
+
+	if( result == false )
+	{
+		return false;
+	}
+
+	//and scale the rest of the way
+	if( (Temp.Width() != goal_x) || (Temp.Height() != goal_y) )
+	{
+		Resample_Image( context, &Temp, D_Weights, goal_x, goal_y, Dest );
+	}
+	else
+	{
+		(*Dest) = Temp;
+	}
+
+	return true;
+} //end CAIR_Hybrid()
+
+//=========================================================================================================//
+//==                                               A S Y N C                                             ==//
+//=========================================================================================================//
+
+//=========================================================================================================//
+//A CAIR() running on its own thread, see CAIR_Start().
+struct CAIR_Job
+{
+	CAIR_Context * context;
+	pthread_t thread;
+	std::atomic<bool> done;
+	bool result;
+
+	//the arguments for CAIR()
+	CML_color * Source;
+	CML_int * S_Weights;
+	int goal_x;
+	int goal_y;
+	int add_weight;
+	CAIR_convolution conv;
+	CAIR_energy ener;
+	CML_int * D_Weights;
+	CML_color * Dest;
+	bool (*CAIR_callback)(float);
+};
+
+//=========================================================================================================//
+//The job's thread.
+void * Job_Thread( void * id )
+{
+	CAIR_Job * job = (CAIR_Job *)id;
+
+	job->result = CAIR( job->context, job->Source, job->S_Weights, job->goal_x, job->goal_y, job->add_weight, job->conv, job->ener, job->D_Weights, job->Dest, job->CAIR_callback );
+	job->done = true;
+
+	return NULL;
+}
+
+//=========================================================================================================//
+//Starts CAIR() on its own thread and returns right away. The arguments are the same as CAIR(), and must stay around until
+//CAIR_Finish() is called. The context can't be used for anything else until then.
+CAIR_Job * CAIR_Start( CAIR_Context * context, CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	CAIR_Job * job = new CAIR_Job;
+	job->context = context;
+	job->done = false;
+	job->result = false;
+	job->Source = Source;
+	job->S_Weights = S_Weights;
+	job->goal_x = goal_x;
+	job->goal_y = goal_y;
+	job->add_weight = add_weight;
+	job->conv = conv;
+	job->ener = ener;
+	job->D_Weights = D_Weights;
+	job->Dest = Dest;
+	job->CAIR_callback = CAIR_callback;
+
+	context->cancel = false;
+	pthread_create( &(job->thread), NULL, Job_Thread, job );
+
+	return job;
+}
+
+//=========================================================================================================//
+//Returns true once the job is done, and CAIR_Finish() won't have to wait.
+bool CAIR_Done( CAIR_Job * job )
+{
+	return job->done;
+}
+
+//=========================================================================================================//
+//Asks the job to stop. The long steps check for this every row, so it stops within a few rows of work.
+//Returns right away, CAIR_Finish() still has to be called.
+void CAIR_Cancel( CAIR_Job * job )
+{
+	job->context->cancel = true;
+}
+
+//=========================================================================================================//
+//Waits for the job to be done and deletes it. Returns what CAIR() returned, which may be false if it was cancelled.
+//Everything the job used has been freed by the time this returns, except for the context's threads (see CAIR_Shutdown()).
+bool CAIR_Finish( CAIR_Job * job )
+{
+	pthread_join( job->thread, NULL );
+
+	bool result = job->result;
+	job->context->cancel = false;
+	delete job;
+
+	return result;
+}
+
+//=========================================================================================================//
+//==                                   D E F A U L T   C O N T E X T                                     ==//
+//=========================================================================================================//
+//The original interface, which runs everything on default_context.
+void CAIR_Threads( int thread_count )
+{
+	CAIR_Threads( &default_context, thread_count );
+}
+
+void CAIR_Affinity( bool pin )
+{
+	CAIR_Affinity( &default_context, pin );
+}
+
+void CAIR_Backend( CAIR_backend backend )
+{
+	CAIR_Backend( &default_context, backend );
+}
+
+void CAIR_Executor( CAIR_executor executor, void * host, int threads )
+{
+	CAIR_Executor( &default_context, executor, host, threads );
+}
+
+void CAIR_Batch( int size, int quality )
+{
+	CAIR_Batch( &default_context, size, quality );
+}
+
+void CAIR_Pyramid( int scale )
+{
+	CAIR_Pyramid( &default_context, scale );
+}
+
+void CAIR_Bands( int bands, int overlap )
+{
+	CAIR_Bands( &default_context, bands, overlap );
+}
+
+void CAIR_Local( int reach, int threshold )
+{
+	CAIR_Local( &default_context, reach, threshold );
+}
+
+void CAIR_Add_Mode( CAIR_add_mode mode )
+{
+	CAIR_Add_Mode( &default_context, mode );
+}
+
+void CAIR_Shutdown()
+{
+	CAIR_Shutdown( &default_context );
+}
+
+bool CAIR( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR( &default_context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+}
+
+void CAIR_Grayscale( CML_color * Source, CML_color * Dest )
+{
+	CAIR_Grayscale( &default_context, Source, Dest );
+}
+
+void CAIR_Edge( CML_color * Source, CAIR_convolution conv, CML_color * Dest )
+{
+	CAIR_Edge( &default_context, Source, conv, Dest );
+}
+
+void CAIR_V_Energy( CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest )
+{
+	CAIR_V_Energy( &default_context, Source, conv, ener, Dest );
+}
+
+void CAIR_H_Energy( CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest )
+{
+	CAIR_H_Energy( &default_context, Source, conv, ener, Dest );
+}
+
+bool CAIR_Removal( CML_color * Source, CML_int * S_Weights, CAIR_direction choice, int max_attempts, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR_Removal( &default_context, Source, S_Weights, choice, max_attempts, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+}
+
+void CAIR_Image_Map( CML_color * Source, CML_int * Weights, CAIR_convolution conv, CAIR_energy ener, CML_int * Map )
+{
+	CAIR_Image_Map( &default_context, Source, Weights, conv, ener, Map );
+}
+
+bool CAIR_HD( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR_HD( &default_context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+}
+
+bool CAIR_Transport( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR_Transport( &default_context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+}
+
+bool CAIR_Ladder( CML_color * Source, CML_int * S_Weights, int * goal_x, int count, CAIR_convolution conv, CAIR_energy ener, CML_int ** D_Weights, CML_color ** Dests, bool (*CAIR_callback)(float), bool (*CAIR_rung)(int) )
+{
+	return CAIR_Ladder( &default_context, Source, S_Weights, goal_x, count, conv, ener, D_Weights, Dests, CAIR_callback, CAIR_rung );
+}
+
+bool CAIR_Seams( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, CAIR_Seam_List * Seams, bool (*CAIR_callback)(float) )
+{
+	return CAIR_Seams( &default_context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, Seams, CAIR_callback );
+}
+
+bool CAIR_Replay( CML_color * Source, CML_int * S_Weights, CAIR_Seam_List * Seams, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR_Replay( &default_context, Source, S_Weights, Seams, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+}
+
+bool CAIR_Apply( CAIR_Seam_List * Seams, CAIR_Plane * Planes, int count )
+{
+	return CAIR_Apply( &default_context, Seams, Planes, count );
+}
+
+bool CAIR_Hybrid( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int seam_budget, int time_budget, int payoff, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR_Hybrid( &default_context, Source, S_Weights, goal_x, goal_y, seam_budget, time_budget, payoff, conv, ener, D_Weights, Dest, CAIR_callback );
+}
+
+CAIR_Job * CAIR_Start( CML_color * Source, CML_int * S_Weights, int goal_x, int goal_y, int add_weight, CAIR_convolution conv, CAIR_energy ener, CML_int * D_Weights, CML_color * Dest, bool (*CAIR_callback)(float) )
+{
+	return CAIR_Start( &default_context, Source, S_Weights, goal_x, goal_y, add_weight, conv, ener, D_Weights, Dest, CAIR_callback );
+}
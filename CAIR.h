@@ -26,14 +26,123 @@
 
 //=========================================================================================================//
 //The default number of threads that will be used for Grayscale, Edge, and Add/Remove operations.
-//Minimum of 2 required.
-#define CAIR_NUM_THREADS 4
+//Zero picks the count for each image, from the number of cores and the size of the image. Small images use just the calling thread.
+#define CAIR_NUM_THREADS 0
 
 //=========================================================================================================//
-//Set the number of threads that CAIR should use. Minimum of 2 required.
+//A context holds CAIR's settings and threads. Every function below also comes in a version that takes a context first; those can be
+//called at the same time from different threads of your program, as long as each one uses its own context. The versions without a
+//context all share a default one, so only one of them can be working at a time (just like before).
+struct CAIR_Context;
+
+//=========================================================================================================//
+//Makes a new context with the default settings. Its threads are started the first time it's used.
+CAIR_Context * CAIR_Create_Context();
+
+//=========================================================================================================//
+//Stops the context's threads and deletes it.
+//WARNING: Never call this function while the context is processing an image, otherwise bad things will happen!
+void CAIR_Destroy_Context( CAIR_Context * context );
+
+//=========================================================================================================//
+//Set the number of threads that CAIR should use. Zero (the default) picks the count for each image, one thread per core, but fewer for
+//smaller images and none at all for very small ones. One does everything on the calling thread, without any threads or locking.
 //WARNING: Never call this function while CAIR() is processing an image, otherwise bad things will happen!
-//Best to set this only once, before any CAIR operations take place.
+//Best to set this only once, before any CAIR operations take place. Changing it restarts the threads on the next call.
 void CAIR_Threads( int thread_count );
+void CAIR_Threads( CAIR_Context * context, int thread_count );
+
+//=========================================================================================================//
+//Pins the threads to cores, spread evenly across them, and keeps each strip of the image on the same thread from seam to seam.
+//Each thread also moves the rows of its strips into its own memory, so on a machine with more than one socket (NUMA) they stay
+//local to it. This only helps large images on such machines. Off by default, and only available on Linux.
+//WARNING: Like CAIR_Threads(), never call this while CAIR() is processing an image. Changing it restarts the threads on the next call.
+void CAIR_Affinity( bool pin );
+void CAIR_Affinity( CAIR_Context * context, bool pin );
+
+//=========================================================================================================//
+//Chooses what runs CAIR's threads. PTHREADS (the default) is CAIR's own pool of threads, which stay up between calls. STD_THREADS
+//starts C++11 threads for each step and joins them when it's done. OPENMP hands each step to OpenMP, which only works when CAIR.cpp
+//is compiled with OpenMP turned on (-fopenmp), otherwise it's the same as SERIAL. SERIAL does everything on the calling thread.
+//Only PTHREADS can overlap the steps of a seam and split up the energy map, so it's usually the fastest.
+//CAIR_Threads() and CAIR_Affinity() still apply, though only PTHREADS can pin its threads.
+//WARNING: Never call this function while CAIR() is processing an image.
+enum CAIR_backend { PTHREADS = 0, STD_THREADS = 1, OPENMP = 2, SERIAL = 3 };
+void CAIR_Backend( CAIR_backend backend );
+void CAIR_Backend( CAIR_Context * context, CAIR_backend backend );
+
+//=========================================================================================================//
+//Lets your program run CAIR's work on its own thread pool, so CAIR doesn't start any threads of its own. executor must call
+//task( data, num ) for every num from 0 to count - 1, in any order and on any of its threads, and only return once they're all done.
+//threads is how many tasks your pool can run at once, which CAIR uses to pick how many pieces to split each step into. host is
+//passed along to executor untouched. A NULL executor goes back to the backend chosen by CAIR_Backend().
+//WARNING: Never call this function while CAIR() is processing an image.
+typedef void (*CAIR_task)( void * data, int num );
+typedef void (*CAIR_executor)( CAIR_task task, void * data, int count, void * host );
+void CAIR_Executor( CAIR_executor executor, void * host, int threads );
+void CAIR_Executor( CAIR_Context * context, CAIR_executor executor, void * host, int threads );
+
+//=========================================================================================================//
+//Turns on batch removal. With a size larger than 1, each energy map will give up to size paths that don't cross each other, which
+//are then removed all at once. Only paths with an energy within quality percent of the best path are taken, so flat images get
+//large batches and busy images get small ones. This is much faster for large reductions, at a slight cost in quality. Every batch
+//has to recalculate the image from scratch, so sizes of 16 or more are where this pays off.
+//A size of 1 (the default) removes one path at a time, as always.
+//WARNING: Never call this function while CAIR() is processing an image.
+void CAIR_Batch( int size, int quality );
+void CAIR_Batch( CAIR_Context * context, int size, int quality );
+
+//=========================================================================================================//
+//Turns on the coarse to fine path search. With a scale larger than 1, paths are first found on the edges summed into blocks of
+//scale x scale pixels. Each coarse path then gives scale paths at full size, found within a band of a block to either side of it.
+//Only that band of the full energy map is calculated, which is much faster on large images, though a path can't wander far from
+//the coarse one. Batch removal (CAIR_Batch()) is skipped while this is on.
+//Scales of 2 or 4 work best. Images smaller than 3 blocks across or down go back to the full map.
+//A scale of 1 (the default) always uses the full energy map.
+//WARNING: Never call this function while CAIR() is processing an image.
+void CAIR_Pyramid( int scale );
+void CAIR_Pyramid( CAIR_Context * context, int scale );
+
+//=========================================================================================================//
+//Turns on banded removal for very wide images. With more than 1 band, the image is split into that many bands side by side, each
+//with overlap extra columns from its neighbors to either side. Each band gets a share of the paths from where the image's
+//lowest energy columns are, and the bands are carved at the same time, each on one thread with its own energy maps. The overlaps
+//are kept out of the carving and then used to blend each band into the next. Much faster on wide images, but a path can't cross
+//from one band into another. Images with bands narrower than twice the overlap go back to the whole image.
+//A cancel or CAIR_callback returning false still stops every band right away. The callback is given how far all of the bands have
+//got together, and is called from the bands' threads, though never from two at once.
+//1 band (the default) carves the whole image at once.
+//WARNING: Never call this function while CAIR() is processing an image.
+void CAIR_Bands( int bands, int overlap );
+void CAIR_Bands( CAIR_Context * context, int bands, int overlap );
+
+//=========================================================================================================//
+//Turns on the local path search. Paths next to each other usually come out one after another, so with a reach over 0, each path
+//is first looked for within reach columns to either side of the last one, in just that band of the energy map. It's kept if its
+//energy is within threshold percent of the best path from the last time the whole energy map was done. Otherwise the whole map
+//is brought up to date and its best path is used, like normal. Large removals skip most of the full energy maps this way.
+//Batch removal (CAIR_Batch()) only happens on the full maps, and CAIR_Pyramid() takes the place of this when it's on.
+//A reach of 0 (the default) always uses the full energy map.
+//WARNING: Never call this function while CAIR() is processing an image.
+void CAIR_Local( int reach, int threshold );
+void CAIR_Local( CAIR_Context * context, int reach, int threshold );
+
+//=========================================================================================================//
+//Chooses how paths are added when enlarging. WEIGHTED (the default) adds one path at a time, using add_weight to keep new paths
+//apart. SEAM_ORDER works like the paper: the paths that would be removed first are found on a copy of the image, then all of them
+//are duplicated in one pass. add_weight is ignored, and no more than half of the width is added in each round.
+//SEAM_ORDER is much faster, costing about as much as removing the same number of paths.
+//WARNING: Never call this function while CAIR() is processing an image.
+enum CAIR_add_mode { WEIGHTED = 0, SEAM_ORDER = 1 };
+void CAIR_Add_Mode( CAIR_add_mode mode );
+void CAIR_Add_Mode( CAIR_Context * context, CAIR_add_mode mode );
+
+//=========================================================================================================//
+//CAIR starts its threads on the first call and keeps them waiting for the next one, so a run of small images doesn't pay to
+//create them each time. This stops the threads and frees everything they use. The next CAIR call will start them up again.
+//WARNING: Never call this function while CAIR() is processing an image, otherwise bad things will happen!
+void CAIR_Shutdown();
+void CAIR_Shutdown( CAIR_Context * context );
 
 //=========================================================================================================//
 //The Great CAIR Frontend. This baby will retarget Source using S_Weights into the dimensions supplied by goal_x and goal_y into D_Weights and Dest.
@@ -69,24 +178,39 @@ bool CAIR( CML_color * Source,
            CML_int * D_Weights,
            CML_color * Dest,
            bool (*CAIR_callback)(float) );
+bool CAIR( CAIR_Context * context,
+           CML_color * Source,
+           CML_int * S_Weights,
+           int goal_x,
+           int goal_y,
+           int add_weight,
+           CAIR_convolution conv,
+           CAIR_energy ener,
+           CML_int * D_Weights,
+           CML_color * Dest,
+           bool (*CAIR_callback)(float) );
 
 //=========================================================================================================//
 //Simple function that generates the grayscale image of Source and places the result in Dest.
 void CAIR_Grayscale( CML_color * Source, CML_color * Dest );
+void CAIR_Grayscale( CAIR_Context * context, CML_color * Source, CML_color * Dest );
 
 //=========================================================================================================//
 //Simple function that generates the edge-detection image of Source and stores it in Dest.
 void CAIR_Edge( CML_color * Source, CAIR_convolution conv, CML_color * Dest );
+void CAIR_Edge( CAIR_Context * context, CML_color * Source, CAIR_convolution conv, CML_color * Dest );
 
 //=========================================================================================================//
 //Simple function that generates the vertical energy map of Source placing it into Dest.
 //All values are scaled down to their relative gray value. Weights are assumed all zero.
 void CAIR_V_Energy( CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest );
+void CAIR_V_Energy( CAIR_Context * context, CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest );
 
 //=========================================================================================================//
 //Simple function that generates the horizontal energy map of Source placing it into Dest.
 //All values are scaled down to their relative gray value. Weights are assumed all zero.
 void CAIR_H_Energy( CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest );
+void CAIR_H_Energy( CAIR_Context * context, CML_color * Source, CAIR_convolution conv, CAIR_energy ener, CML_color * Dest );
 
 //=========================================================================================================//
 //Experimental
@@ -106,6 +230,17 @@ bool CAIR_Removal( CML_color * Source,
                    CML_int * D_Weights,
                    CML_color * Dest,
                    bool (*CAIR_callback)(float) );
+bool CAIR_Removal( CAIR_Context * context,
+                   CML_color * Source,
+                   CML_int * S_Weights,
+                   CAIR_direction choice,
+                   int max_attempts,
+                   int add_weight,
+                   CAIR_convolution conv,
+                   CAIR_energy ener,
+                   CML_int * D_Weights,
+                   CML_color * Dest,
+                   bool (*CAIR_callback)(float) );
 
 //=========================================================================================================//
 //Experimental
@@ -116,6 +251,7 @@ bool CAIR_Removal( CML_color * Source,
 //in the doctor's presentation. The next logical step would be to encode Map into an existing image format. Then, using a function like
 //CAIR_Map_Resize() the image can be resized on a client machine with very little overhead.
 void CAIR_Image_Map( CML_color * Source, CML_int * Weights, CAIR_convolution conv, CAIR_energy ener, CML_int * Map );
+void CAIR_Image_Map( CAIR_Context * context, CML_color * Source, CML_int * Weights, CAIR_convolution conv, CAIR_energy ener, CML_int * Map );
 
 //=========================================================================================================//
 //Experimental
@@ -139,5 +275,271 @@ bool CAIR_HD( CML_color * Source,
               CML_int * D_Weights,
               CML_color * Dest,
               bool (*CAIR_callback)(float) );
+bool CAIR_HD( CAIR_Context * context,
+              CML_color * Source,
+              CML_int * S_Weights,
+              int goal_x,
+              int goal_y,
+              int add_weight,
+              CAIR_convolution conv,
+              CAIR_energy ener,
+              CML_int * D_Weights,
+              CML_color * Dest,
+              bool (*CAIR_callback)(float) );
+
+//=========================================================================================================//
+//Like CAIR_HD(), this mixes the paths down and across the image when removing in both directions, but the order is planned
+//ahead of time instead of picked one path at a time. The plan is the "transport map" from the paper: the cheapest way to every
+//pair of path counts. It's found on a copy of the image shrunk to about 64x64, so it costs little next to the resize itself,
+//and then the full image is carved in that order. Enlarging is done just like CAIR(). Inputs are the same as CAIR().
+bool CAIR_Transport( CML_color * Source,
+                     CML_int * S_Weights,
+                     int goal_x,
+                     int goal_y,
+                     int add_weight,
+                     CAIR_convolution conv,
+                     CAIR_energy ener,
+                     CML_int * D_Weights,
+                     CML_color * Dest,
+                     bool (*CAIR_callback)(float) );
+bool CAIR_Transport( CAIR_Context * context,
+                     CML_color * Source,
+                     CML_int * S_Weights,
+                     int goal_x,
+                     int goal_y,
+                     int add_weight,
+                     CAIR_convolution conv,
+                     CAIR_energy ener,
+                     CML_int * D_Weights,
+                     CML_color * Dest,
+                     bool (*CAIR_callback)(float) );
+
+//=========================================================================================================//
+//Makes count narrower versions of Source from a single carving run, for when many sizes of the same image are needed.
+//goal_x holds the widths, in any order. The seams are removed down to the smallest one, and each result is copied into
+//Dests[i] and D_Weights[i] as the run passes goal_x[i], so the work on the way down is shared by all of them. A width at or
+//over the width of Source gets a plain copy. The height doesn't change. CAIR_rung may be NULL; otherwise it's called with i as
+//soon as Dests[i] is ready, and returning false stops the run (as does CAIR_callback). Without CAIR_Batch(), each result is the
+//same as a CAIR() to its width. With it, batches are cut short at each width, so the results may differ slightly.
+//Returns false, before anything is carved, if any width is less than 1.
+bool CAIR_Ladder( CML_color * Source,
+                  CML_int * S_Weights,
+                  int * goal_x,
+                  int count,
+                  CAIR_convolution conv,
+                  CAIR_energy ener,
+                  CML_int ** D_Weights,
+                  CML_color ** Dests,
+                  bool (*CAIR_callback)(float),
+                  bool (*CAIR_rung)(int) );
+bool CAIR_Ladder( CAIR_Context * context,
+                  CML_color * Source,
+                  CML_int * S_Weights,
+                  int * goal_x,
+                  int count,
+                  CAIR_convolution conv,
+                  CAIR_energy ener,
+                  CML_int ** D_Weights,
+                  CML_color ** Dests,
+                  bool (*CAIR_callback)(float),
+                  bool (*CAIR_rung)(int) );
+
+//=========================================================================================================//
+//The paths CAIR_Seams() removed and added, in the order it used them, so CAIR_Replay() can do the same to another image.
+//width and height are the size of the image they were found on, and goal_x and goal_y what it was resized to. Like CAIR(), the paths
+//down the image come out first, then the ones across it, and then the same for adding. Each path is the column it took on each row
+//of the image at the time (or the row on each column, for paths across the image). Since a path only moves a pixel at a time, it's
+//kept as where it starts in Starts(0,path), and then how far it moves on each row after that in row path of Steps (-1, 0 or 1).
+struct CAIR_Seam_List
+{
+	CAIR_Seam_List() : Starts( 1, 1 ), Steps( 1, 1 ) { width = 0; height = 0; goal_x = 0; goal_y = 0; count = 0; }
+
+	int width;
+	int height;
+	int goal_x;
+	int goal_y;
+	int count;
+	CML_int Starts;
+	CML_dir Steps;
+};
+
+//=========================================================================================================//
+//Works just like CAIR(), and keeps every path it removes and adds in Seams. Enlarging is always done one path at a time here
+//(the WEIGHTED add mode), so that each added path can be kept. For the same reason CAIR_Bands() is ignored, and the whole width
+//is carved as one band.
+bool CAIR_Seams( CML_color * Source,
+                 CML_int * S_Weights,
+                 int goal_x,
+                 int goal_y,
+                 int add_weight,
+                 CAIR_convolution conv,
+                 CAIR_energy ener,
+                 CML_int * D_Weights,
+                 CML_color * Dest,
+                 CAIR_Seam_List * Seams,
+                 bool (*CAIR_callback)(float) );
+bool CAIR_Seams( CAIR_Context * context,
+                 CML_color * Source,
+                 CML_int * S_Weights,
+                 int goal_x,
+                 int goal_y,
+                 int add_weight,
+                 CAIR_convolution conv,
+                 CAIR_energy ener,
+                 CML_int * D_Weights,
+                 CML_color * Dest,
+                 CAIR_Seam_List * Seams,
+                 bool (*CAIR_callback)(float) );
+
+//=========================================================================================================//
+//Does the resize recorded in Seams to Source, which is usually a larger version of that image (or one that lines up with it).
+//Source must be at least as large as the image Seams was made from. If it's N times as wide, every path in the list stands for
+//N paths here, each found at full size within a band around where the list's path would be (like CAIR_Pyramid()). So the result is
+//Source with N times as many columns taken out or put in, and the same goes for the rows. A Source the same size as the list's image
+//follows its paths to within a pixel or so. Returns false if Source is too small for the list, or on a cancel.
+bool CAIR_Replay( CML_color * Source,
+                  CML_int * S_Weights,
+                  CAIR_Seam_List * Seams,
+                  int add_weight,
+                  CAIR_convolution conv,
+                  CAIR_energy ener,
+                  CML_int * D_Weights,
+                  CML_color * Dest,
+                  bool (*CAIR_callback)(float) );
+bool CAIR_Replay( CAIR_Context * context,
+                  CML_color * Source,
+                  CML_int * S_Weights,
+                  CAIR_Seam_List * Seams,
+                  int add_weight,
+                  CAIR_convolution conv,
+                  CAIR_energy ener,
+                  CML_int * D_Weights,
+                  CML_color * Dest,
+                  bool (*CAIR_callback)(float) );
+
+//=========================================================================================================//
+//An extra plane of the image for CAIR_Apply() to carve, like an alpha mask, a depth map, or a segmentation. It can hold any
+//element type, since it's only ever moved around whole. Use CAIR_Plane_Of() to make one from a CML_Matrix.
+struct CAIR_Plane
+{
+	void * matrix;
+	int size; //bytes in each element
+	int width;
+	int height;
+	unsigned char * (*Row)( void * matrix, int y );
+	void (*Resize)( void * matrix, int width, int height );
+};
+
+template <class T> unsigned char * CAIR_Plane_Row( void * matrix, int y )
+{
+	return (unsigned char *)&(*(CML_Matrix<T> *)matrix)(0,y);
+}
+
+template <class T> void CAIR_Plane_Resize( void * matrix, int width, int height )
+{
+	(*(CML_Matrix<T> *)matrix).D_Resize( width, height );
+}
+
+template <class T> CAIR_Plane CAIR_Plane_Of( CML_Matrix<T> * Matrix )
+{
+	CAIR_Plane plane;
+	plane.matrix = Matrix;
+	plane.size = sizeof(T);
+	plane.width = (*Matrix).Width();
+	plane.height = (*Matrix).Height();
+	plane.Row = CAIR_Plane_Row<T>;
+	plane.Resize = CAIR_Plane_Resize<T>;
+	return plane;
+}
+
+//=========================================================================================================//
+//Carves each of the count Planes the way CAIR_Seams() carved the image Seams was made from, so they stay lined up with it. The
+//planes must be the same size as that image. Elements are only ever removed or copied, never blended, so masks and labels keep
+//their values. All of the planes are done together in one threaded pass. Returns false if a plane is the wrong size.
+bool CAIR_Apply( CAIR_Seam_List * Seams,
+                 CAIR_Plane * Planes,
+                 int count );
+bool CAIR_Apply( CAIR_Context * context,
+                 CAIR_Seam_List * Seams,
+                 CAIR_Plane * Planes,
+                 int count );
+
+//=========================================================================================================//
+//Shrinks the image by carving as far as it pays off, and then scaling the rest of the way, for a predictable cost on extreme
+//resizes. Paths are removed like CAIR() until seam_budget paths are out or time_budget milliseconds have gone by (-1 for no limit
+//on either), or the next path would cost payoff percent of an average path on the first energy map of that direction (the mean of
+//its bottom row, so forward energy and weights count the same as for the paths, 0 for no limit). At 100, carving stops once a path
+//takes out about as much as scaling would. The image is then resampled to goal_x by goal_y: averaged down when shrinking,
+//blended when enlarging. Enlarging is never carved. D_Weights is scaled along with the image by taking the nearest weight.
+//Returns false if a goal is less than 1, or on a cancel.
+bool CAIR_Hybrid( CML_color * Source,
+                  CML_int * S_Weights,
+                  int goal_x,
+                  int goal_y,
+                  int seam_budget,
+                  int time_budget,
+                  int payoff,
+                  CAIR_convolution conv,
+                  CAIR_energy ener,
+                  CML_int * D_Weights,
+                  CML_color * Dest,
+                  bool (*CAIR_callback)(float) );
+bool CAIR_Hybrid( CAIR_Context * context,
+                  CML_color * Source,
+                  CML_int * S_Weights,
+                  int goal_x,
+                  int goal_y,
+                  int seam_budget,
+                  int time_budget,
+                  int payoff,
+                  CAIR_convolution conv,
+                  CAIR_energy ener,
+                  CML_int * D_Weights,
+                  CML_color * Dest,
+                  bool (*CAIR_callback)(float) );
+
+//=========================================================================================================//
+//Starts CAIR() on a thread of its own and returns a handle to it right away, so the caller doesn't have to wait.
+//The inputs are the same as CAIR(), and must be left alone until CAIR_Finish() is called. The context (or the default one)
+//can't be used for anything else in the meantime.
+struct CAIR_Job;
+CAIR_Job * CAIR_Start( CML_color * Source,
+                       CML_int * S_Weights,
+                       int goal_x,
+                       int goal_y,
+                       int add_weight,
+                       CAIR_convolution conv,
+                       CAIR_energy ener,
+                       CML_int * D_Weights,
+                       CML_color * Dest,
+                       bool (*CAIR_callback)(float) );
+CAIR_Job * CAIR_Start( CAIR_Context * context,
+                       CML_color * Source,
+                       CML_int * S_Weights,
+                       int goal_x,
+                       int goal_y,
+                       int add_weight,
+                       CAIR_convolution conv,
+                       CAIR_energy ener,
+                       CML_int * D_Weights,
+                       CML_color * Dest,
+                       bool (*CAIR_callback)(float) );
+
+//=========================================================================================================//
+//Returns true once the job is done, so CAIR_Finish() won't block.
+bool CAIR_Done( CAIR_Job * job );
+
+//=========================================================================================================//
+//Asks the job to stop, and returns right away. Unlike returning false from CAIR_callback, which is only checked once per seam,
+//this is also checked every row inside the long steps (like the first edge detection and energy map of a huge image), so the
+//job stops within a few rows of work. CAIR_Finish() must still be called, and may return false (the job can finish before it
+//notices); if it does, the destination is in an unknown state.
+void CAIR_Cancel( CAIR_Job * job );
+
+//=========================================================================================================//
+//Waits for the job to be done, deletes it, and returns what CAIR() returned. After a cancel this may return false; if it does,
+//Dest and D_Weights are in an unknown state.
+//Everything the job allocated is freed by the time this returns; only the context's threads stay up (see CAIR_Shutdown()).
+bool CAIR_Finish( CAIR_Job * job );
 
 #endif //CAIR_H
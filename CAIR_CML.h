@@ -204,6 +204,18 @@ public:
 		current_x = x;
 	}
 
+	//=========================================================================================================//
+	//Non-destructive resize in the y direction. The rows past the new height are kept around, so this can't grow
+	//the matrix past the height it was allocated with.
+	void Resize_Height( int y )
+	{
+		if( y > max_y )
+		{
+			y = max_y;
+		}
+		current_y = y;
+	}
+
 	//=========================================================================================================//
 	//Destructive memory reservation for the internal matrix.
 	//The reported size of the image does not change.
@@ -217,6 +229,17 @@ public:
 		//current_x and y didn't change
 	}
 
+	//=========================================================================================================//
+	//Moves row y into new memory allocated by the calling thread. The memory a thread allocates and touches first usually
+	//ends up close to the core it's running on, so this lets each thread pull over the rows it works on.
+	void Move_Row( int y )
+	{
+		T * row = new T[max_x];
+		std::memcpy( row, matrix[y], current_x*sizeof(T) );
+		delete[] matrix[y];
+		matrix[y] = row;
+	}
+
 	//=========================================================================================================//
 	//Shift a row where the first element in the shift is supplied as x,y.
 	//The amount/direction of the shift is supplied in shift.
@@ -307,5 +330,6 @@ private:
 typedef CML_Matrix<CML_RGBA> CML_color;
 typedef CML_Matrix<CML_byte> CML_gray;
 typedef CML_Matrix<int> CML_int;
+typedef CML_Matrix<signed char> CML_dir;
 
 #endif //CAIR_CML_H
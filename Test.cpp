@@ -0,0 +1,227 @@
+//=========================================================================================================//
+//CAIR Regression Tests
+
+//=========================================================================================================//
+//Copyright (C) 2008 Joseph Auman (brain.recall@gmail.com)
+
+//=========================================================================================================//
+//This library is free software; you can redistribute it and/or
+//modify it under the terms of the GNU Lesser General Public
+//License as published by the Free Software Foundation; either
+//version 2.1 of the License, or (at your option) any later version.
+//This library is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//Lesser General Public License for more details.
+//You should have received a copy of the GNU Lesser General Public
+//License along with this library; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+//=========================================================================================================//
+//Runs a few resizes on made up images and checks what comes back. Run it with "make test", which builds it with the address
+//sanitizer so anything that walks off an image fails here too.
+//=========================================================================================================//
+
+#include <iostream>
+#include "CAIR.h"
+#include "CAIR_CML.h"
+
+using namespace std;
+
+int failures = 0;
+int callbacks = 0;
+
+//=========================================================================================================//
+//Counts the calls, and stops the resize on the fifth.
+bool Stop_Callback( float done )
+{
+	callbacks++;
+	return ( callbacks < 5 );
+}
+
+//=========================================================================================================//
+//Fills Image with diagonal stripes that bend back and forth, so the least energy paths wander across the whole image.
+void Make_Image( CML_color * Image, int width, int height )
+{
+	(*Image).D_Resize( width, height );
+	for( int y = 0; y < height; y++ )
+	{
+		for( int x = 0; x < width; x++ )
+		{
+			int bend = ( (y / 40) % 2 == 0 ) ? (y % 40) : 40 - (y % 40);
+			CML_RGBA pixel;
+			pixel.red = (CML_byte)( ((x + 3 * bend) % 23 < 4) ? 255 : (x * 7 + y * 3) % 64 );
+			pixel.green = (CML_byte)( ((x + y) % 37 < 3) ? 200 : (x * y) % 50 );
+			pixel.blue = (CML_byte)( (x * 13 + y * 5) % 90 );
+			pixel.alpha = 0;
+			(*Image)(x,y) = pixel;
+		}
+	}
+}
+
+//=========================================================================================================//
+//Averages each scale_x by scale_y block of Source into one pixel of Dest.
+void Shrink_Image( CML_color * Source, CML_color * Dest, int scale_x, int scale_y )
+{
+	int width = (*Source).Width() / scale_x;
+	int height = (*Source).Height() / scale_y;
+	(*Dest).D_Resize( width, height );
+	for( int y = 0; y < height; y++ )
+	{
+		for( int x = 0; x < width; x++ )
+		{
+			int red = 0, green = 0, blue = 0;
+			for( int j = 0; j < scale_y; j++ )
+			{
+				for( int i = 0; i < scale_x; i++ )
+				{
+					CML_RGBA pixel = (*Source)(x * scale_x + i, y * scale_y + j);
+					red += pixel.red;
+					green += pixel.green;
+					blue += pixel.blue;
+				}
+			}
+			CML_RGBA pixel;
+			pixel.red = (CML_byte)( red / (scale_x * scale_y) );
+			pixel.green = (CML_byte)( green / (scale_x * scale_y) );
+			pixel.blue = (CML_byte)( blue / (scale_x * scale_y) );
+			pixel.alpha = 0;
+			(*Dest)(x,y) = pixel;
+		}
+	}
+}
+
+//=========================================================================================================//
+void Check( bool passed, const char * name )
+{
+	cout << ( passed ? "PASS: " : "FAIL: " ) << name << endl;
+	if( passed == false )
+	{
+		failures++;
+	}
+}
+
+//=========================================================================================================//
+//Finds the paths on a proxy of Source that was shrunk by scale_x and scale_y, then replays them on Source (see CAIR_Replay()).
+//Every weight of both is set to weight.
+void Test_Replay( int width, int height, int scale_x, int scale_y, int goal_x, int goal_y, int weight, CAIR_energy ener, const char * name )
+{
+	CML_color Source( 1, 1 );
+	Make_Image( &Source, width, height );
+	CML_int Weights( width, height );
+	Weights.Fill( weight );
+
+	CML_color Proxy( 1, 1 );
+	Shrink_Image( &Source, &Proxy, scale_x, scale_y );
+	CML_int Proxy_Weights( Proxy.Width(), Proxy.Height() );
+	Proxy_Weights.Fill( weight );
+
+	CML_color Proxy_Dest( 1, 1 );
+	CML_int Proxy_D_Weights( 1, 1 );
+	CAIR_Seam_List Seams;
+	bool passed = CAIR_Seams( &Proxy, &Proxy_Weights, goal_x * Proxy.Width() / width, goal_y * Proxy.Height() / height, 10, PREWITT, ener, &Proxy_D_Weights, &Proxy_Dest, &Seams, NULL );
+
+	CML_color Dest( 1, 1 );
+	CML_int D_Weights( 1, 1 );
+	passed = passed && CAIR_Replay( &Source, &Weights, &Seams, 10, PREWITT, ener, &D_Weights, &Dest, NULL );
+	passed = passed && (Dest.Width() > 0) && (Dest.Height() > 0);
+	passed = passed && ( (goal_x <= width) ? (Dest.Width() <= width) : (Dest.Width() > width) );
+	passed = passed && ( (goal_y <= height) ? (Dest.Height() <= height) : (Dest.Height() > height) );
+	Check( passed, name );
+}
+
+//=========================================================================================================//
+//Carves Source down to goal_x with every weight at weight.
+void Test_Weighted( int width, int height, int goal_x, int weight, const char * name )
+{
+	CML_color Source( 1, 1 );
+	Make_Image( &Source, width, height );
+	CML_int Weights( width, height );
+	Weights.Fill( weight );
+
+	CML_color Dest( 1, 1 );
+	CML_int D_Weights( 1, 1 );
+	bool passed = CAIR( &Source, &Weights, goal_x, height, 10, PREWITT, BACKWARD, &D_Weights, &Dest, NULL );
+	passed = passed && (Dest.Width() == goal_x) && (Dest.Height() == height);
+	Check( passed, name );
+}
+
+//=========================================================================================================//
+//Makes a 200x100 image at the widths first and second with CAIR_Ladder(), which should give back result.
+void Test_Ladder( int first, int second, bool result, const char * name )
+{
+	CML_color Source( 1, 1 );
+	Make_Image( &Source, 200, 100 );
+	CML_int Weights( 200, 100 );
+	Weights.Fill( 0 );
+
+	int goal_x[2] = { first, second };
+	CML_color Dest_0( 1, 1 ), Dest_1( 1, 1 );
+	CML_int D_Weights_0( 1, 1 ), D_Weights_1( 1, 1 );
+	CML_color * Dests[2] = { &Dest_0, &Dest_1 };
+	CML_int * D_Weights[2] = { &D_Weights_0, &D_Weights_1 };
+	bool passed = ( CAIR_Ladder( &Source, &Weights, goal_x, 2, PREWITT, BACKWARD, D_Weights, Dests, NULL, NULL ) == result );
+	if( result == true )
+	{
+		passed = passed && (Dest_0.Width() == first) && (Dest_1.Width() == second);
+	}
+	Check( passed, name );
+}
+
+//=========================================================================================================//
+//Carves a wide image in bands, with a CAIR_callback that stops it on the fifth call. The bands have to report their progress and
+//stop when it says to, instead of only hearing about it once they're done.
+void Test_Bands_Stop( const char * name )
+{
+	CML_color Source( 1, 1 );
+	Make_Image( &Source, 800, 200 );
+	CML_int Weights( 800, 200 );
+	Weights.Fill( 0 );
+
+	CML_color Dest( 1, 1 );
+	CML_int D_Weights( 1, 1 );
+	CAIR_Bands( 2, 16 );
+	callbacks = 0;
+	bool passed = ( CAIR( &Source, &Weights, 400, 200, 10, PREWITT, BACKWARD, &D_Weights, &Dest, Stop_Callback ) == false );
+	passed = passed && (callbacks == 5);
+	CAIR_Bands( 1, 0 );
+	Check( passed, name );
+}
+
+//=========================================================================================================//
+int main()
+{
+	//proxies that were shrunk more one way than the other, so the replay's bands move over faster than a path can follow
+	Test_Replay( 640, 480, 4, 1, 300, 200, 0, BACKWARD, "replay, proxy shrunk 4x1" );
+	Test_Replay( 640, 480, 4, 1, 300, 200, 0, FORWARD, "replay, proxy shrunk 4x1, forward energy" );
+	Test_Replay( 640, 480, 1, 4, 300, 200, 0, BACKWARD, "replay, proxy shrunk 1x4" );
+	Test_Replay( 640, 480, 8, 2, 400, 300, 0, BACKWARD, "replay, proxy shrunk 8x2" );
+
+	//the same amount both ways
+	Test_Replay( 640, 480, 2, 2, 400, 300, 0, BACKWARD, "replay, proxy shrunk 2x2" );
+
+	//taking out every column, which leaves nothing for the energy update
+	Test_Weighted( 200, 100, 0, 0, "carving to a width of 0" );
+	Test_Ladder( 150, 1, true, "ladder down to a width of 1" );
+	Test_Ladder( 150, 0, false, "ladder with a width of 0 is refused" );
+
+	//weights large enough that the real path energies go past the band walls
+	CAIR_Pyramid( 4 );
+	Test_Weighted( 80, 600, 60, 1000000, "pyramid, weights of 1000000" );
+	CAIR_Pyramid( 1 );
+	Test_Replay( 120, 600, 2, 2, 80, 600, 1000000, BACKWARD, "replay, weights of 1000000" );
+	Test_Replay( 120, 600, 2, 2, 160, 600, 1000000, BACKWARD, "replay enlarging, weights of 1000000" );
+	CAIR_Local( 8, 10 );
+	Test_Weighted( 80, 600, 20, 1000000, "local, weights of 1000000" );
+	CAIR_Local( 0, 10 );
+
+	Test_Bands_Stop( "bands stop when the callback says to" );
+
+	if( failures > 0 )
+	{
+		cout << failures << " test(s) failed." << endl;
+		return 1;
+	}
+	cout << "All tests passed." << endl;
+	return 0;
+}
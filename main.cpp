@@ -27,7 +27,7 @@
 #include "CAIR_CML.h"
 #include "./EasyBMP/EasyBMP.h"
 
-enum Arg_Param { INPUT_FILENAME = 0, GOAL_X, GOAL_Y, ADD_WEIGHT, OUTPUT_FILENAME, RESULT_TYPE, CONVOLUTION, WEIGHT_FILENAME, WEIGHT_SCALE, ENERGY_TYPE, THREAD_COUNT };
+enum Arg_Param { INPUT_FILENAME = 0, GOAL_X, GOAL_Y, ADD_WEIGHT, OUTPUT_FILENAME, RESULT_TYPE, CONVOLUTION, WEIGHT_FILENAME, WEIGHT_SCALE, ENERGY_TYPE, THREAD_COUNT, BATCH_SIZE, BATCH_QUALITY, ADD_MODE, PIN_THREADS, BACKEND, PYRAMID_SCALE, PROXY_FILENAME, PLANE_FILENAME, SPLIT_BANDS, LOCAL_REACH, SEAM_BUDGET, TIME_BUDGET, PAYOFF };
 
 using namespace std;
 
@@ -131,6 +131,45 @@ char * getArgParameter( Arg_Param arg, int argc, char * argv[] )
 	case THREAD_COUNT :
 		sToBeFind = "-T";
 		break;
+	case BATCH_SIZE :
+		sToBeFind = "-B";
+		break;
+	case BATCH_QUALITY :
+		sToBeFind = "-Q";
+		break;
+	case ADD_MODE :
+		sToBeFind = "-M";
+		break;
+	case PIN_THREADS :
+		sToBeFind = "-P";
+		break;
+	case BACKEND :
+		sToBeFind = "-U";
+		break;
+	case PYRAMID_SCALE :
+		sToBeFind = "-G";
+		break;
+	case PROXY_FILENAME :
+		sToBeFind = "-V";
+		break;
+	case PLANE_FILENAME :
+		sToBeFind = "-K";
+		break;
+	case SPLIT_BANDS :
+		sToBeFind = "-N";
+		break;
+	case LOCAL_REACH :
+		sToBeFind = "-L";
+		break;
+	case SEAM_BUDGET :
+		sToBeFind = "-H";
+		break;
+	case TIME_BUDGET :
+		sToBeFind = "-J";
+		break;
+	case PAYOFF :
+		sToBeFind = "-F";
+		break;
 	}
 
 	for ( int i = 1 ; i < argc ; i++ )//minus one, because we return the next
@@ -169,6 +208,9 @@ void Print_Usage()
 	cout << "      Horizontal Energy: 4" << endl;
 	cout << "      Removal: 5" << endl;
 	cout << "      CAIR_HD: 6" << endl;
+	cout << "      CAIR_Transport: 7" << endl;
+	cout << "      CAIR_Replay: 8 (paths found on -V)" << endl;
+	cout << "      CAIR_Hybrid: 9 (within -H, -J and -F)" << endl;
 	cout << "      Default: CAIR" << endl;
 	cout << "  -C <convoluton_type>" << endl;
 	cout << "      Prewitt: 0" << endl;
@@ -182,7 +224,52 @@ void Print_Usage()
 	cout << "      Forward: 1" << endl;
 	cout << "      Default: Backward" << endl;
 	cout << "  -T <thread_count>" << endl;
+	cout << "      Automatic: 0" << endl;
 	cout << "      Default : CAIR_NUM_THREADS (" << CAIR_NUM_THREADS << ")" << endl;
+	cout << "  -B <batch_size>" << endl;
+	cout << "      Paths removed per energy map" << endl;
+	cout << "      Default : 1" << endl;
+	cout << "  -Q <batch_quality>" << endl;
+	cout << "      Percent over the best path a batch path may cost" << endl;
+	cout << "      Default : 0" << endl;
+	cout << "  -M <add_mode>" << endl;
+	cout << "      Weighted: 0" << endl;
+	cout << "      Seam Order: 1" << endl;
+	cout << "      Default: Weighted" << endl;
+	cout << "  -P <pin_threads>" << endl;
+	cout << "      Pin threads to cores (Linux): 1" << endl;
+	cout << "      Default: 0" << endl;
+	cout << "  -U <thread_backend>" << endl;
+	cout << "      pthreads: 0" << endl;
+	cout << "      std::thread: 1" << endl;
+	cout << "      OpenMP: 2" << endl;
+	cout << "      Serial: 3" << endl;
+	cout << "      Default: pthreads" << endl;
+	cout << "  -V <proxy_file>" << endl;
+	cout << "      Smaller copy of the input for CAIR_Replay" << endl;
+	cout << "      Default: the input itself" << endl;
+	cout << "  -K <plane_file>" << endl;
+	cout << "      Bitmap the same size as the input, carved along with it by CAIR_Apply" << endl;
+	cout << "      into outputPlane.bmp (CAIR only)" << endl;
+	cout << "  -G <pyramid_scale>" << endl;
+	cout << "      Find paths on the image shrunk by this much" << endl;
+	cout << "      Default : 1" << endl;
+	cout << "  -N <bands>" << endl;
+	cout << "      Carve this many bands at once, overlapping by 16 columns" << endl;
+	cout << "      Default : 1" << endl;
+	cout << "  -L <local_reach>" << endl;
+	cout << "      Look this far from the last path first, keeping what's within" << endl;
+	cout << "      -Q percent (10 if not given) of the last full energy map's best" << endl;
+	cout << "      Default : 0" << endl;
+	cout << "  -H <seam_budget>" << endl;
+	cout << "      Most paths CAIR_Hybrid carves before scaling" << endl;
+	cout << "      Default : -1 (no limit)" << endl;
+	cout << "  -J <time_budget>" << endl;
+	cout << "      Most milliseconds CAIR_Hybrid carves for before scaling" << endl;
+	cout << "      Default : -1 (no limit)" << endl;
+	cout << "  -F <payoff>" << endl;
+	cout << "      CAIR_Hybrid scales once a path costs this percent of an average one" << endl;
+	cout << "      Default : 100 (0 for no limit)" << endl;
 	cout << "http://sourceforge.net/projects/c-a-i-r/" << endl;
 }
 
@@ -317,6 +404,15 @@ int main( int argc, char * argv[] )
 		case 6 :
 			output_filename = "outputHD.bmp";
 			break;
+		case 7 :
+			output_filename = "outputTransport.bmp";
+			break;
+		case 8 :
+			output_filename = "outputReplay.bmp";
+			break;
+		case 9 :
+			output_filename = "outputHybrid.bmp";
+			break;
 		}
 	}
 
@@ -349,6 +445,64 @@ int main( int argc, char * argv[] )
 		CAIR_Threads( atoi(temp) );
 	}
 
+	//the -B and -Q params
+	int batch = 1;
+	int quality = 0;
+	temp = getArgParameter( BATCH_SIZE, argc, argv );
+	if( temp != NULL )
+	{
+		batch = atoi(temp);
+	}
+	temp = getArgParameter( BATCH_QUALITY, argc, argv );
+	if( temp != NULL )
+	{
+		quality = atoi(temp);
+	}
+	CAIR_Batch( batch, quality );
+
+	//the -M param
+	temp = getArgParameter( ADD_MODE, argc, argv );
+	if( temp != NULL )
+	{
+		CAIR_Add_Mode( (CAIR_add_mode)atoi(temp) );
+	}
+
+	//the -P param
+	temp = getArgParameter( PIN_THREADS, argc, argv );
+	if( temp != NULL )
+	{
+		CAIR_Affinity( atoi(temp) != 0 );
+	}
+
+	//the -U param
+	temp = getArgParameter( BACKEND, argc, argv );
+	if( temp != NULL )
+	{
+		CAIR_Backend( (CAIR_backend)atoi(temp) );
+	}
+
+	//the -G param
+	temp = getArgParameter( PYRAMID_SCALE, argc, argv );
+	if( temp != NULL )
+	{
+		CAIR_Pyramid( atoi(temp) );
+	}
+
+	//the -N param
+	temp = getArgParameter( SPLIT_BANDS, argc, argv );
+	if( temp != NULL )
+	{
+		CAIR_Bands( atoi(temp), 16 );
+	}
+
+	//the -L param
+	temp = getArgParameter( LOCAL_REACH, argc, argv );
+	if( temp != NULL )
+	{
+		char * threshold = getArgParameter( BATCH_QUALITY, argc, argv );
+		CAIR_Local( atoi(temp), (threshold != NULL) ? atoi(threshold) : 10 );
+	}
+
 	
 	//the -W param
 	//set weights
@@ -387,7 +541,28 @@ int main( int argc, char * argv[] )
 	switch( result_type )
 	{
 	case 0 :
-		CAIR( &Source, &Weights, goal_x, goal_y, add_weight, convolution, ener, &D_Weights, &Dest, NULL ); //try cancel_callback
+		if( getArgParameter( PLANE_FILENAME, argc, argv ) == NULL )
+		{
+			CAIR( &Source, &Weights, goal_x, goal_y, add_weight, convolution, ener, &D_Weights, &Dest, NULL ); //try cancel_callback
+		}
+		else
+		{
+			//keep the paths, then carve the plane the same way
+			BMP plane;
+			plane.ReadFromFile( getArgParameter( PLANE_FILENAME, argc, argv ) );
+			CML_color Plane( plane.TellWidth(), plane.TellHeight() );
+			BMP_to_CML( &plane, &Plane );
+
+			CAIR_Seam_List Seams;
+			CAIR_Seams( &Source, &Weights, goal_x, goal_y, add_weight, convolution, ener, &D_Weights, &Dest, &Seams, NULL );
+			CAIR_Plane Planes = CAIR_Plane_Of( &Plane );
+			if( CAIR_Apply( &Seams, &Planes, 1 ) == true )
+			{
+				plane.SetSize( Plane.Width(), Plane.Height() );
+				CML_to_BMP( &Plane, &plane );
+				plane.WriteToFile( "outputPlane.bmp" );
+			}
+		}
 		break;
 	case 1 :
 		CAIR_Grayscale( &Source, &Dest );
@@ -407,7 +582,46 @@ int main( int argc, char * argv[] )
 	case 6 :
 		CAIR_HD( &Source, &Weights, goal_x, goal_y, add_weight, convolution, ener, &D_Weights, &Dest, NULL );
 		break;
+	case 7 :
+		CAIR_Transport( &Source, &Weights, goal_x, goal_y, add_weight, convolution, ener, &D_Weights, &Dest, NULL );
+		break;
+	case 8 :
+		{
+			//find the paths on the proxy, scaling the goals down to it, then carve the input the same way
+			CML_color Proxy( 1, 1 );
+			CML_int Proxy_Weights( 1, 1 );
+			Proxy = Source;
+			Proxy_Weights = Weights;
+			char * proxy_filename = getArgParameter( PROXY_FILENAME, argc, argv );
+			if( proxy_filename != NULL )
+			{
+				BMP proxy;
+				proxy.ReadFromFile( proxy_filename );
+				Proxy.D_Resize( proxy.TellWidth(), proxy.TellHeight() );
+				BMP_to_CML( &proxy, &Proxy );
+				Proxy_Weights.D_Resize( proxy.TellWidth(), proxy.TellHeight() );
+				Proxy_Weights.Fill( 0 );
+			}
+
+			CML_color Proxy_Dest( 1, 1 );
+			CML_int Proxy_D_Weights( 1, 1 );
+			CAIR_Seam_List Seams;
+			int proxy_x = goal_x * Proxy.Width() / Source.Width();
+			int proxy_y = goal_y * Proxy.Height() / Source.Height();
+			CAIR_Seams( &Proxy, &Proxy_Weights, (proxy_x > 0) ? proxy_x : 1, (proxy_y > 0) ? proxy_y : 1, add_weight, convolution, ener, &Proxy_D_Weights, &Proxy_Dest, &Seams, NULL );
+			CAIR_Replay( &Source, &Weights, &Seams, add_weight, convolution, ener, &D_Weights, &Dest, NULL );
+		}
+		break;
+	case 9 :
+		{
+			char * seam_budget = getArgParameter( SEAM_BUDGET, argc, argv );
+			char * time_budget = getArgParameter( TIME_BUDGET, argc, argv );
+			char * payoff = getArgParameter( PAYOFF, argc, argv );
+			CAIR_Hybrid( &Source, &Weights, goal_x, goal_y, (seam_budget != NULL) ? atoi(seam_budget) : -1, (time_budget != NULL) ? atoi(time_budget) : -1, (payoff != NULL) ? atoi(payoff) : 100, convolution, ener, &D_Weights, &Dest, NULL );
+		}
+		break;
 	}
+	CAIR_Shutdown();
 		
 	Resized.SetSize( Dest.Width(), Dest.Height() );
 	CML_to_BMP( &Dest, &Resized );